@@ -0,0 +1,253 @@
+// ============================= METADATA BENCH ============================= //
+// Project:         epidemium_oncobase
+// Name:            metadata_bench.cpp
+// Description:     Counts the system calls of listing and reading articles
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * metadata_bench.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O3 -I../src
+//                  metadata_bench.cpp -o metadata_bench -lstdc++fs -lpthread
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <map>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <experimental/filesystem>
+// Include others
+#include <signal.h>
+#include <unistd.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include "file.hpp"
+#include "article.hpp"
+#include "directory_walker.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using milliseconds = std::chrono::duration<double, std::milli>;
+using clock_type = std::chrono::steady_clock;
+namespace filesystem = std::experimental::filesystem;
+// ========================================================================== //
+
+
+
+// -------------------------------- LEGACY ---------------------------------- //
+// Queries the metadata of a path as the constructor of file did before the
+// lazy metadata, with one call per property
+void legacy_file(const filesystem::path& p)
+{
+    filesystem::file_type type = filesystem::file_type::none;
+    std::uintmax_t size = 0;
+    filesystem::file_time_type time;
+    if (filesystem::exists(p)) {
+        type = filesystem::status(p).type();
+        if (type != filesystem::file_type::directory) {
+            size = filesystem::file_size(p);
+        }
+        time = filesystem::last_write_time(p);
+    }
+    static_cast<void>(size);
+    static_cast<void>(time);
+}
+
+// Loads an article as article::load did before the lazy metadata, building
+// a second file for the absolute path and checking the existence of both
+std::size_t legacy_load(const filesystem::path& p)
+{
+    const filesystem::path absolute = filesystem::absolute(p);
+    std::ifstream stream;
+    std::ostringstream text;
+    legacy_file(p);
+    if (filesystem::exists(p)) {
+        legacy_file(absolute);
+    }
+    if (filesystem::exists(absolute)) {
+        stream.open(absolute.string());
+        text<<stream.rdbuf();
+    }
+    return text.str().size();
+}
+
+// Lists and loads the articles of a corpus as the main program did before the
+// lazy metadata, through a recursive directory iterator and a file per entry
+std::size_t legacy_run(const std::string& corpus)
+{
+    std::size_t result = 0;
+    std::vector<filesystem::path> paths;
+    for (auto&& entry: filesystem::recursive_directory_iterator(corpus)) {
+        if (entry.path().extension() == ".txt") {
+            legacy_file(entry.path());
+            paths.push_back(entry.path());
+        }
+    }
+    for (auto&& p: paths) {
+        result += legacy_load(p);
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------------- CURRENT --------------------------------- //
+// Lists the articles of a corpus with their metadata fetched by the walker
+// and maps them as the main program does
+std::size_t current_run(const std::string& corpus)
+{
+    std::size_t result = 0;
+    std::vector<std::string> paths;
+    article paper;
+    auto filter = [](auto&& p){return p.extension() == ".txt";};
+    directory_walker(1).walk_files(corpus, filter, [&](auto&& batch){
+        for (auto&& f: batch) {
+            paths.push_back(f.path().string());
+        }
+    });
+    for (auto&& p: paths) {
+        paper.map(p);
+        result += paper.view().size();
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------------- COUNTING --------------------------------- //
+// Runs a function in a child traced with its threads, and counts the system
+// calls it makes and the ones of the stat family among them, which is only
+// supported on x86-64
+template <class F>
+bool count_calls(F&& f, std::size_t& stats, std::size_t& calls)
+{
+    std::map<pid_t, bool> inside;
+    pid_t child = 0;
+    pid_t thread = 0;
+    int status = 0;
+    int signal = 0;
+    bool supported = false;
+    stats = 0;
+    calls = 0;
+#if defined(__x86_64__)
+    const long options = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE
+                       | PTRACE_O_EXITKILL;
+    user_regs_struct registers = user_regs_struct();
+    unsigned long long number = 0;
+    supported = true;
+    child = ::fork();
+    if (child == 0) {
+        ::ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        ::raise(SIGSTOP);
+        f();
+        std::_Exit(0);
+    }
+    ::waitpid(child, &status, 0);
+    ::ptrace(PTRACE_SETOPTIONS, child, nullptr, options);
+    ::ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+    while ((thread = ::waitpid(-1, &status, __WALL)) > 0) {
+        signal = 0;
+        if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+            inside[thread] = !inside[thread];
+            if (inside[thread]
+            &&  ::ptrace(PTRACE_GETREGS, thread, nullptr, &registers) == 0) {
+                number = registers.orig_rax;
+                stats += number == SYS_stat || number == SYS_lstat
+                      || number == SYS_fstat || number == SYS_newfstatat
+                      || number == SYS_statx;
+                ++calls;
+            }
+        } else if (WIFSTOPPED(status) && WSTOPSIG(status) != SIGTRAP
+               &&  WSTOPSIG(status) != SIGSTOP) {
+            signal = WSTOPSIG(status);
+        }
+        if (WIFSTOPPED(status)) {
+            ::ptrace(PTRACE_SYSCALL, thread, nullptr, signal);
+        }
+    }
+#endif
+    static_cast<void>(child);
+    static_cast<void>(thread);
+    static_cast<void>(signal);
+    static_cast<void>(f);
+    return supported;
+}
+
+// Times the best of a number of runs of a function
+template <class F>
+milliseconds best(F&& f, std::size_t passes)
+{
+    milliseconds result = milliseconds::max();
+    clock_type::time_point start;
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        start = clock_type::now();
+        f();
+        result = std::min(result, milliseconds(clock_type::now() - start));
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Reads the .txt articles of a corpus both ways, and prints the number of
+// bytes read, the system calls counted in a traced run and the best time of
+// the untraced runs of each
+int main(int argc, char** argv)
+{
+    // Variables
+    const std::string corpus = argc > 1 ? argv[1] : ".";
+    const std::size_t passes = argc > 2 ? std::stoul(argv[2]) : 5;
+    std::size_t legacy_bytes = 0;
+    std::size_t current_bytes = 0;
+    std::size_t stats = 0;
+    std::size_t calls = 0;
+    milliseconds time;
+    auto legacy = [&](){legacy_bytes = legacy_run(corpus);};
+    auto current = [&](){current_bytes = current_run(corpus);};
+
+    // Runs and prints both ways
+    time = best(legacy, passes);
+    std::cout<<"legacy:  "<<legacy_bytes<<" bytes, ";
+    if (count_calls(legacy, stats, calls)) {
+        std::cout<<stats<<" stat calls, "<<calls<<" system calls, ";
+    }
+    std::cout<<time.count()<<" ms"<<std::endl;
+    time = best(current, passes);
+    std::cout<<"current: "<<current_bytes<<" bytes, ";
+    if (count_calls(current, stats, calls)) {
+        std::cout<<stats<<" stat calls, "<<calls<<" system calls, ";
+    }
+    std::cout<<time.count()<<" ms"<<std::endl;
+    return 0;
+}
+/* ************************************************************************** */
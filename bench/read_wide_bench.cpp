@@ -0,0 +1,142 @@
+// ============================ READ WIDE BENCH ============================= //
+// Project:         epidemium_oncobase
+// Name:            read_wide_bench.cpp
+// Description:     Times read_wide against the former codecvt round trip
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * read_wide_bench.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O3 -I../src
+//                  read_wide_bench.cpp -o read_wide_bench -lstdc++fs
+//                  -lpthread
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <chrono>
+#include <string>
+#include <vector>
+#include <locale>
+#include <codecvt>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+// Include others
+#include "file.hpp"
+#include "directory_walker.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using milliseconds = std::chrono::duration<double, std::milli>;
+using clock_type = std::chrono::steady_clock;
+// ========================================================================== //
+
+
+
+// -------------------------------- LEGACY ---------------------------------- //
+// Reads a file as file::read_wide did before the utf-8 validation: decoded
+// to wide characters by the codecvt facet, then encoded back to utf-8
+std::string legacy_read_wide(const std::string& filename)
+{
+    using facet_type = std::codecvt_utf8<wchar_t>;
+    static const std::locale locale(std::locale(), new facet_type);
+    std::string data;
+    std::wstring_convert<facet_type, wchar_t> converter;
+    std::wifstream stream(filename, std::ios::in);
+    std::wstringstream sstream;
+    std::wstring text;
+    stream.imbue(locale);
+    sstream.imbue(locale);
+    if (stream.good()) {
+        sstream << stream.rdbuf();
+        text = static_cast<const std::wstringstream&>(sstream).str();
+        data = converter.to_bytes(text);
+        stream.close();
+    }
+    return data;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Reads every .txt and .nxml file of a corpus with both versions for a number
+// of passes, and prints the best time of a pass of each, their throughput and
+// the number of files read identically
+int main(int argc, char** argv)
+{
+    // Variables
+    const std::string corpus = argc > 1 ? argv[1] : ".";
+    const std::size_t passes = argc > 2 ? std::stoul(argv[2]) : 5;
+    auto filter = [](auto&& p){
+        return p.extension() == ".txt" || p.extension() == ".nxml";
+    };
+    std::vector<std::string> paths;
+    std::vector<std::string> legacy;
+    std::vector<std::string> current;
+    clock_type::time_point start;
+    milliseconds legacy_time = milliseconds::max();
+    milliseconds current_time = milliseconds::max();
+    std::size_t bytes = 0;
+    std::size_t identical = 0;
+
+    // Lists the files and reads them with both versions, keeping the texts of
+    // the last pass
+    directory_walker(1).walk(corpus, filter, [&](auto&& batch){
+        for (auto&& p: batch) {
+            paths.push_back(p.string());
+        }
+    });
+    std::sort(paths.begin(), paths.end());
+    legacy.resize(paths.size());
+    current.resize(paths.size());
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        start = clock_type::now();
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            legacy[i] = legacy_read_wide(paths[i]);
+        }
+        legacy_time = std::min(legacy_time,
+                               milliseconds(clock_type::now() - start));
+        start = clock_type::now();
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            file(paths[i]).read_wide(current[i]);
+        }
+        current_time = std::min(current_time,
+                                milliseconds(clock_type::now() - start));
+    }
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        bytes += current[i].size();
+        identical += legacy[i] == current[i];
+    }
+
+    // Prints the results
+    std::cout<<paths.size()<<" files, "<<bytes<<" bytes, best of ";
+    std::cout<<passes<<" passes"<<std::endl;
+    std::cout<<"legacy:  "<<legacy_time.count()<<" ms, ";
+    std::cout<<bytes / legacy_time.count() / 1000.<<" MB/s"<<std::endl;
+    std::cout<<"current: "<<current_time.count()<<" ms, ";
+    std::cout<<bytes / current_time.count() / 1000.<<" MB/s"<<std::endl;
+    std::cout<<"identical: "<<identical<<" of "<<paths.size()<<std::endl;
+    return 0;
+}
+/* ************************************************************************** */
@@ -0,0 +1,256 @@
+// ============================ WORD COUNT BENCH ============================ //
+// Project:         epidemium_oncobase
+// Name:            word_count_bench.cpp
+// Description:     Times word counting on workers with their own accumulators
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * word_count_bench.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O3 -I../src
+//                  word_count_bench.cpp -o word_count_bench -lstdc++fs
+//                  -lpthread
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+// Include others
+#include "article.hpp"
+#include "pipeline.hpp"
+#include "memory_map.hpp"
+#include "vocabulary.hpp"
+#include "directory_walker.hpp"
+#include "cooccurrence_matrix.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using milliseconds = std::chrono::duration<double, std::milli>;
+using clock_type = std::chrono::steady_clock;
+// ========================================================================== //
+
+
+
+// ------------------------------ ACCUMULATORS ------------------------------ //
+// Item passed from the loading to the counting
+struct job
+{
+    std::string path;
+    memory_map contents;
+};
+
+// Counters of a worker: its article, the word distribution of the current
+// article, the totals of the words indexed by identifier, and the articles
+// where the target words occur together
+struct accumulator
+{
+    article paper;
+    article::id_distribution ids;
+    std::vector<std::size_t> totals;
+    cooccurrence_matrix cooccurrences;
+};
+
+// Outcome of a run over the corpus: the total of each word, sorted by word,
+// and the cooccurrence counts of the target words
+struct outcome
+{
+    std::vector<std::pair<std::string, std::size_t>> totals;
+    std::vector<cooccurrence_matrix::count_type> cooccurrences;
+};
+
+// Counts the words of an article after waiting for the given delay, and adds
+// them to the counters of a worker, the target words being the first ones of
+// the vocabulary
+void count(accumulator& a, job& j, vocabulary& words, std::size_t ntargets,
+           milliseconds delay)
+{
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+    a.paper.adopt(j.path, std::move(j.contents));
+    a.paper.compute_id_distribution(a.ids, words);
+    for (auto&& p: a.ids) {
+        if (p.first >= a.totals.size()) {
+            a.totals.resize(std::max(a.totals.size() * 2,
+                                     std::size_t(p.first) + 1), 0);
+        }
+        a.totals[p.first] += p.second;
+        if (p.first < ntargets) {
+            a.cooccurrences.insert(p.first);
+        }
+    }
+    a.cooccurrences.commit();
+    a.paper.clear();
+}
+
+// Merges the counters of the workers, and spells out the totals of the words
+outcome merge(std::vector<accumulator>& workers, const vocabulary& words,
+              std::size_t ntargets)
+{
+    outcome result;
+    std::vector<std::size_t> totals(words.size(), 0);
+    cooccurrence_matrix cooccurrences(ntargets);
+    for (auto&& a: workers) {
+        for (std::size_t id = 0; id < a.totals.size(); ++id) {
+            totals[id] += a.totals[id];
+        }
+        cooccurrences.merge(a.cooccurrences);
+    }
+    for (std::size_t id = 0; id < totals.size(); ++id) {
+        if (totals[id]) {
+            result.totals.emplace_back(
+                std::string(words.word(static_cast<vocabulary::id_type>(id))),
+                totals[id]
+            );
+        }
+    }
+    std::sort(result.totals.begin(), result.totals.end());
+    for (std::size_t i = 0; i < ntargets; ++i) {
+        for (std::size_t k = 0; k < ntargets; ++k) {
+            result.cooccurrences.push_back(cooccurrences.count(i, k));
+        }
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------------- RUNS ---------------------------------- //
+// Loads and counts the articles one after the other on the calling thread
+outcome serial(const std::vector<std::string>& paths,
+               const std::vector<std::string>& targets, milliseconds delay)
+{
+    vocabulary words;
+    std::vector<accumulator> workers(1);
+    job j;
+    for (auto&& t: targets) {
+        words.insert(t);
+    }
+    workers[0].cooccurrences.resize(targets.size());
+    for (auto&& p: paths) {
+        j.path = p;
+        j.contents.open(j.path, true);
+        count(workers[0], j, words, targets.size(), delay);
+    }
+    return merge(workers, words, targets.size());
+}
+
+// Loads the articles on one thread and counts them on a pool of workers
+// sharing a vocabulary, each keeping its own counters, merged once at the end
+outcome pooled(const std::vector<std::string>& paths,
+               const std::vector<std::string>& targets, milliseconds delay,
+               std::size_t nthreads)
+{
+    vocabulary words;
+    std::vector<accumulator> workers(nthreads);
+    pipeline<job> stages;
+    for (auto&& t: targets) {
+        words.insert(t);
+    }
+    for (auto&& a: workers) {
+        a.cooccurrences.resize(targets.size());
+    }
+    stages.add("load", [](std::size_t, job& j){
+        j.contents.open(j.path, true);
+        return true;
+    }, 1);
+    stages.add("count", [&](std::size_t w, job& j){
+        count(workers[w], j, words, targets.size(), delay);
+        return true;
+    }, nthreads);
+    stages.run(paths.begin(), paths.end(), [](job& j, const std::string& p){
+        j.path = p;
+    }, [](job&){});
+    return merge(workers, words, targets.size());
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Counts the words of the .txt articles of a corpus and the cooccurrences of
+// the cancer words, serially and on pools of 1, 2, 4, 8 and 16 workers, each
+// article waiting for an injected delay standing for a slow read, zero for a
+// run bound by the processor, and prints the best time of each and whether
+// the merged counters of the pools match the serial ones
+int main(int argc, char** argv)
+{
+    // Constants
+    static const std::vector<std::size_t> thread_counts = {1, 2, 4, 8, 16};
+    static const std::vector<std::string> targets = {
+        "cancer", "breast", "treatment", "carcinoma", "chemotherapy",
+        "colorectal", "ovarian", "gastric", "lung", "serum", "prostate",
+        "melanoma", "renal"
+    };
+
+    // Variables
+    const std::string corpus = argc > 1 ? argv[1] : ".";
+    const milliseconds delay(argc > 2 ? std::stod(argv[2]) : 2.);
+    const std::size_t passes = argc > 3 ? std::stoul(argv[3]) : 3;
+    auto filter = [](auto&& p){return p.extension() == ".txt";};
+    std::vector<std::string> paths;
+    clock_type::time_point start;
+    milliseconds time;
+    outcome expected;
+    outcome result;
+    bool same = true;
+
+    // Lists the articles
+    directory_walker(1).walk(corpus, filter, [&](auto&& batch){
+        for (auto&& p: batch) {
+            paths.push_back(p.string());
+        }
+    });
+    std::sort(paths.begin(), paths.end());
+    std::cout<<paths.size()<<" articles, "<<delay.count();
+    std::cout<<" ms per article, best of "<<passes<<" passes"<<std::endl;
+
+    // Times the serial run, then the pools of each size
+    time = milliseconds::max();
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        start = clock_type::now();
+        expected = serial(paths, targets, delay);
+        time = std::min(time, milliseconds(clock_type::now() - start));
+    }
+    std::cout<<"serial: "<<time.count()<<" ms, "<<expected.totals.size();
+    std::cout<<" words"<<std::endl;
+    for (auto&& n: thread_counts) {
+        time = milliseconds::max();
+        for (std::size_t pass = 0; pass < passes; ++pass) {
+            start = clock_type::now();
+            result = pooled(paths, targets, delay, n);
+            time = std::min(time, milliseconds(clock_type::now() - start));
+            same = same && result.totals == expected.totals
+                 && result.cooccurrences == expected.cooccurrences;
+        }
+        std::cout<<n<<" workers: "<<time.count()<<" ms"<<std::endl;
+    }
+    std::cout<<"identical: "<<(same ? "yes" : "no")<<std::endl;
+    return same ? 0 : 1;
+}
+/* ************************************************************************** */
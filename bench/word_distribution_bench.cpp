@@ -0,0 +1,172 @@
+// ======================== WORD DISTRIBUTION BENCH ========================= //
+// Project:         epidemium_oncobase
+// Name:            word_distribution_bench.cpp
+// Description:     Times the word distribution against the former std::map one
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * word_distribution_bench.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O3 -I../src
+//                  word_distribution_bench.cpp -o word_distribution_bench
+//                  -lstdc++fs -lpthread
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <map>
+#include <deque>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+// Include others
+#include "article.hpp"
+#include "directory_walker.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using milliseconds = std::chrono::duration<double, std::milli>;
+using clock_type = std::chrono::steady_clock;
+// ========================================================================== //
+
+
+
+// -------------------------------- LEGACY ---------------------------------- //
+// Computes the word distribution of a text as article did before the
+// tokenizer, with a lowercase std::string per token counted in a std::map
+article::word_distribution legacy_word_distribution(const std::string& text)
+{
+    using pair = article::word_distribution::value_type;
+    using associative_container = std::map<pair::first_type, pair::second_type>;
+    auto sorter = [](const pair& p, const pair& q){return p.second > q.second;};
+    auto finder = [](char c){return std::isspace(c) || std::iscntrl(c);};
+    auto punct = [](char c){return std::ispunct(c);};
+    auto low = [](char c){return std::tolower(c);};
+    auto first = text.begin();
+    auto last = first;
+    auto rfirst = text.rbegin();
+    auto rlast = rfirst;
+    associative_container map;
+    article::word_distribution distribution;
+    std::string w;
+    while (last < text.end()) {
+        first = std::find_if_not(last, text.end(), finder);
+        last = std::find_if(first, text.end(), finder);
+        if (first < last) {
+            first = std::find_if_not(first, last, punct);
+            rfirst = std::reverse_iterator<decltype(last)>(last);
+            rlast = std::reverse_iterator<decltype(first)>(first);
+            rfirst = std::find_if_not(rfirst, rlast, punct);
+            last = rfirst.base();
+            if (first < last) {
+                w = std::string(first, last);
+                std::transform(std::begin(w), std::end(w), std::begin(w), low);
+                ++map[w];
+            }
+        }
+    }
+    distribution.reserve(map.size());
+    for (auto it = std::begin(map); it != std::end(map); ++it) {
+        distribution.emplace_back(*it);
+    }
+    std::sort(std::begin(distribution), std::end(distribution), sorter);
+    return distribution;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Loads every .txt and .nxml article of a corpus, computes their word
+// distributions with both versions for a number of passes, and prints the
+// best time of a pass of each, their throughput and the number of articles
+// whose distributions are identical as sets
+int main(int argc, char** argv)
+{
+    // Variables
+    const std::string corpus = argc > 1 ? argv[1] : ".";
+    const std::size_t passes = argc > 2 ? std::stoul(argv[2]) : 5;
+    auto filter = [](auto&& p){
+        return p.extension() == ".txt" || p.extension() == ".nxml";
+    };
+    std::vector<std::string> paths;
+    std::deque<article> papers;
+    std::vector<std::string> texts;
+    std::vector<article::word_distribution> legacy;
+    std::vector<article::word_distribution> current;
+    clock_type::time_point start;
+    milliseconds legacy_time = milliseconds::max();
+    milliseconds current_time = milliseconds::max();
+    std::size_t bytes = 0;
+    std::size_t identical = 0;
+
+    // Lists and loads the articles, and computes their distributions with
+    // both versions, keeping the ones of the last pass
+    directory_walker(1).walk(corpus, filter, [&](auto&& batch){
+        for (auto&& p: batch) {
+            paths.push_back(p.string());
+        }
+    });
+    std::sort(paths.begin(), paths.end());
+    for (auto&& p: paths) {
+        papers.emplace_back(p);
+        papers.back().load();
+        texts.emplace_back(papers.back().view());
+        bytes += texts.back().size();
+    }
+    legacy.resize(paths.size());
+    current.resize(paths.size());
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        start = clock_type::now();
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            legacy[i] = legacy_word_distribution(texts[i]);
+        }
+        legacy_time = std::min(legacy_time,
+                               milliseconds(clock_type::now() - start));
+        start = clock_type::now();
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            current[i] = papers[i].compute_word_distribution();
+        }
+        current_time = std::min(current_time,
+                                milliseconds(clock_type::now() - start));
+    }
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        std::sort(legacy[i].begin(), legacy[i].end());
+        std::sort(current[i].begin(), current[i].end());
+        identical += legacy[i] == current[i];
+    }
+
+    // Prints the results
+    std::cout<<paths.size()<<" articles, "<<bytes<<" bytes, best of ";
+    std::cout<<passes<<" passes"<<std::endl;
+    std::cout<<"legacy:  "<<legacy_time.count()<<" ms, ";
+    std::cout<<bytes / legacy_time.count() / 1000.<<" MB/s"<<std::endl;
+    std::cout<<"current: "<<current_time.count()<<" ms, ";
+    std::cout<<bytes / current_time.count() / 1000.<<" MB/s"<<std::endl;
+    std::cout<<"identical: "<<identical<<" of "<<paths.size()<<std::endl;
+    return 0;
+}
+/* ************************************************************************** */
@@ -0,0 +1,238 @@
+// ================================= ARENA ================================== //
+// Project:         epidemium_oncobase
+// Name:            arena.hpp
+// Description:     A block allocator of characters released all at once
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * arena.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _ARENA_HPP_INCLUDED
+#define _ARENA_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+// Include others
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ********************************* ARENA ********************************** */
+// Arena class definition
+class arena
+{
+    // Types
+    public:
+    using value_type = char;
+    using size_type = std::size_t;
+    using pointer = value_type*;
+    using block_type = std::unique_ptr<value_type[]>;
+
+    // Constants
+    public:
+    static constexpr size_type block = 1 << 16;
+
+    // Lifecycle
+    public:
+    explicit arena(size_type nblock = block);
+    arena(arena&& other) noexcept;
+
+    // Assignment
+    public:
+    arena& operator=(arena&& other) noexcept;
+
+    // Access
+    public:
+    size_type size() const noexcept;
+    size_type capacity() const noexcept;
+    size_type block_size() const noexcept;
+
+    // Allocation
+    public:
+    pointer allocate(size_type count);
+
+    // Management
+    public:
+    void clear() noexcept;
+    void release() noexcept;
+
+    // Implementation details: data members
+    private:
+    std::vector<std::pair<block_type, size_type>> _blocks;
+    size_type _block;
+    size_type _current;
+    size_type _used;
+    size_type _size;
+};
+/* ************************************************************************** */
+
+
+
+// ---------------------------- ARENA: LIFECYCLE ---------------------------- //
+// Constructs an empty arena allocating blocks of the given size
+arena::
+arena(size_type nblock)
+: _blocks()
+, _block(std::max(nblock, size_type(1)))
+, _current(0)
+, _used(0)
+, _size(0)
+{
+}
+
+// Constructs an arena by stealing the blocks of another arena
+arena::
+arena(arena&& other)
+noexcept
+: _blocks(std::move(other._blocks))
+, _block(other._block)
+, _current(other._current)
+, _used(other._used)
+, _size(other._size)
+{
+    other._blocks.clear();
+    other._current = 0;
+    other._used = 0;
+    other._size = 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- ARENA: ASSIGNMENT ---------------------------- //
+// Releases the current blocks and steals the ones of another arena
+arena&
+arena::
+operator=(arena&& other)
+noexcept
+{
+    if (this != &other) {
+        release();
+        std::swap(_blocks, other._blocks);
+        std::swap(_block, other._block);
+        std::swap(_current, other._current);
+        std::swap(_used, other._used);
+        std::swap(_size, other._size);
+    }
+    return *this;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------------- ARENA: ACCESS ------------------------------ //
+// Returns the number of characters allocated since the last clear
+arena::size_type
+arena::
+size()
+const noexcept
+{
+    return _size;
+}
+
+// Returns the number of characters held by all the blocks
+arena::size_type
+arena::
+capacity()
+const noexcept
+{
+    size_type result = 0;
+    for (auto&& b: _blocks) {
+        result += b.second;
+    }
+    return result;
+}
+
+// Returns the default size of the blocks
+arena::size_type
+arena::
+block_size()
+const noexcept
+{
+    return _block;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- ARENA: ALLOCATION ---------------------------- //
+// Returns storage for the given number of characters, valid until the arena
+// is cleared, reusing the blocks kept from previous uses first
+arena::pointer
+arena::
+allocate(size_type count)
+{
+    while (_current < _blocks.size()
+    &&     _used + count > _blocks[_current].second) {
+        ++_current;
+        _used = 0;
+    }
+    if (_current == _blocks.size()) {
+        const size_type n = std::max(count, _block);
+        _blocks.emplace_back(block_type(new value_type[n]), n);
+        _used = 0;
+    }
+    _used += count;
+    _size += count;
+    return _blocks[_current].first.get() + _used - count;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- ARENA: MANAGEMENT ---------------------------- //
+// Invalidates all the allocations while keeping the blocks for reuse
+void
+arena::
+clear()
+noexcept
+{
+    _current = 0;
+    _used = 0;
+    _size = 0;
+}
+
+// Invalidates all the allocations and frees the blocks
+void
+arena::
+release()
+noexcept
+{
+    _blocks.clear();
+    clear();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _ARENA_HPP_INCLUDED
+// ========================================================================== //
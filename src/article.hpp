@@ -40,6 +40,16 @@
 #include <algorithm>
 // Include others
 #include "file.hpp"
+#include "utf8.hpp"
+#include "memory_map.hpp"
+#include "tokenizer.hpp"
+#include "vocabulary.hpp"
+#include "term_matcher.hpp"
+#include "word_counter.hpp"
+#include "ngram_counter.hpp"
+#include "nxml_extractor.hpp"
+#include "distribution.hpp"
+#include "string_view.hpp"
 // Miscellaneous
 namespace epidemium_oncobase {
 // ========================================================================== //
@@ -65,6 +75,9 @@ class article
     using reverse_iterator = string_type::reverse_iterator;
     using const_reverse_iterator = string_type::const_reverse_iterator;
     using word_distribution = std::vector<std::pair<string_type, std::size_t>>;
+    using term_type = term_matcher::id_type;
+    using term_distribution = std::vector<std::pair<term_type, std::size_t>>;
+    using id_distribution = word_counter::id_distribution;
     
     // Lifecycle
     public:
@@ -81,23 +94,65 @@ class article
     const_reverse_iterator rend() const noexcept;
     const_reverse_iterator crend() const noexcept;
     
+    // Access
+    public:
+    string_view view() const;
+    nxml_extractor& extractor() noexcept;
+    
     // Management
     public:
     void load(const std::string& filename = "");
+    void map(const std::string& filename = "");
+    void adopt(const std::string& filename, memory_map&& contents);
     void clear();
+    void release();
     
     // Algorithms
     public:
-    word_distribution compute_word_distribution();
+    word_distribution compute_word_distribution(
+        std::size_t minimum = 0, size_type k = distribution::npos
+    );
+    distribution compute_distribution(std::size_t minimum = 0);
+    void compute_distribution(distribution& result, std::size_t minimum = 0);
+    id_distribution compute_id_distribution(
+        vocabulary& words, std::size_t minimum = 0
+    );
+    void compute_id_distribution(
+        id_distribution& result, vocabulary& words, std::size_t minimum = 0
+    );
+    distribution compute_ngram_distribution(
+        size_type n, std::size_t minimum = 0
+    );
+    void compute_ngram_distribution(
+        distribution& d, size_type n, std::size_t minimum = 0
+    );
+    term_distribution compute_term_distribution(
+        const term_matcher& terms, std::size_t minimum = 0
+    );
+    void compute_term_distribution(
+        term_distribution& result, const term_matcher& terms,
+        std::size_t minimum = 0
+    );
     
     // Streaming
     public:
     friend std::ostream& operator<<(std::ostream &os, const article& a);
     
+    // Implementation details: validation
+    private:
+    void _extract();
+    void _validate();
+
     // Implementation details: data members
     private:
     std::string _text;
+    memory_map _map;
     file _file;
+    word_counter _counter;
+    ngram_counter _ngrams;
+    std::vector<std::size_t> _term_counts;
+    std::vector<term_type> _terms;
+    nxml_extractor _extractor;
 };
 /* ************************************************************************** */
 
@@ -108,7 +163,13 @@ class article
 article::
 article(const std::string& filename)
 : _text()
+, _map()
 , _file(filename)
+, _counter()
+, _ngrams()
+, _term_counts()
+, _terms()
+, _extractor()
 {
 }
 // -------------------------------------------------------------------------- //
@@ -122,7 +183,7 @@ article::
 begin() 
 const noexcept
 {
-    return _text.cbegin();
+    return view().begin();
 }
 
 // Returns a constant iterator to the first element of the text 
@@ -131,7 +192,7 @@ article::
 cbegin() 
 const noexcept
 {
-    return _text.cbegin();
+    return view().cbegin();
 }
 
 // Returns an iterator to the last element of the text
@@ -140,7 +201,7 @@ article::
 end() 
 const noexcept
 {
-    return _text.cend();
+    return view().end();
 }
 
 // Returns a constant iterator to the last element of the text 
@@ -149,7 +210,7 @@ article::
 cend() 
 const noexcept
 {
-    return _text.cend();
+    return view().cend();
 }
 
 // Returns an iterator to the first element of the reversed text 
@@ -158,7 +219,7 @@ article::
 rbegin() 
 const noexcept
 {
-    return _text.crbegin();
+    return view().rbegin();
 }
 
 // Returns a constant iterator to the first element of the reversed text 
@@ -167,7 +228,7 @@ article::
 crbegin() 
 const noexcept
 {
-    return _text.crbegin();
+    return view().crbegin();
 }
 
 // Returns an iterator to the last element of the reversed text 
@@ -176,7 +237,7 @@ article::
 rend() 
 const noexcept
 {
-    return _text.crend();
+    return view().rend();
 }
 
 // Returns a constant iterator to the last element of the reversed text 
@@ -185,86 +246,256 @@ article::
 crend() 
 const noexcept
 {
-    return _text.crend();
+    return view().crend();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------- ARTICLE: ACCESS ----------------------------- //
+// Returns a view over the text, whether it has been loaded or mapped
+string_view
+article::
+view()
+const
+{
+    return _map.is_open() ? _map.view() : string_view(_text);
+}
+
+// Returns the extractor selecting the sections kept from nxml files
+nxml_extractor&
+article::
+extractor()
+noexcept
+{
+    return _extractor;
 }
 // -------------------------------------------------------------------------- //
 
 
 
 // --------------------------- ARTICLE: MANAGEMENT -------------------------- //
-// Loads the current file or a new file
+// Loads the current file or a new file, keeping only the text of the selected
+// sections of nxml markup
 void
 article::
 load(const std::string& filename)
 {
     if (filename.size()) {
-        _file = file(filename);
-        if (_file.get_existence()) {
-            _file = file(_file.get_absolute_path());
-        }
+        _file = file(std::experimental::filesystem::absolute(filename));
     }
-    if (_file.get_existence()) {
+    _map.close();
+    if (_file.existence()) {
         if (_file.extension() == ".txt") {
-            _text = _file.read_wide();
+            _file.read_wide(_text);
         } else if (_file.extension() == ".nxml") {
-            _text = _file.read_wide();
+            _map = _file.map();
+            _extract();
+            if (_map.is_open()) {
+                _text.assign(_map.data(), _map.size());
+                _map.close();
+                utf8_repair(_text);
+            }
         }
     }
 }
 
-// Clears the current contents
+// Maps the current file or a new file in memory, without copying the text
+void
+article::
+map(const std::string& filename)
+{
+    if (filename.size()) {
+        _file = file(std::experimental::filesystem::absolute(filename));
+    }
+    _text.clear();
+    _map.close();
+    if (_file.extension() == ".txt") {
+        _map = _file.map();
+    } else if (_file.extension() == ".nxml") {
+        _map = _file.map();
+    }
+    _extract();
+    _validate();
+}
+
+// Takes over a mapping of a new file, already filled by another thread
+void
+article::
+adopt(const std::string& filename, memory_map&& contents)
+{
+    _file = file(filename);
+    _text.clear();
+    _map.close();
+    if (_file.extension() == ".txt" || _file.extension() == ".nxml") {
+        _map = std::move(contents);
+    }
+    _extract();
+    _validate();
+}
+
+// Clears the current contents, keeping the storage of the text and of the
+// counter so that the next articles reuse it until a larger one comes
 void
 article::
 clear()
 {
     _text.clear();
+    _map.close();
+}
+
+// Clears the current contents and frees the storage kept for reuse
+void
+article::
+release()
+{
+    clear();
     _text.shrink_to_fit();
+    _counter = word_counter();
+    _ngrams = ngram_counter();
+    std::vector<std::size_t>().swap(_term_counts);
+    std::vector<term_type>().swap(_terms);
 }
 // -------------------------------------------------------------------------- //
 
 
 
 // --------------------------- ARTICLE: ALGORITHMS -------------------------- //
-// Computes the word distribution in the article
+// Computes the distribution of the k most frequent words in the article
+// among those counted at least the minimum number of times, sorted by
+// decreasing count then alphabetically
 article::word_distribution
 article::
-compute_word_distribution()
+compute_word_distribution(std::size_t minimum, size_type k)
 {
-    using pair = word_distribution::value_type;
-    using associative_container = std::map<pair::first_type, pair::second_type>;
-    auto sorter = [](const pair& p, const pair& q){return p.second > q.second;};
-    auto finder = [](char c){return std::isspace(c) || std::iscntrl(c);};
-    auto punct = [](char c){return std::ispunct(c);};
-    auto low = [](char c){return std::tolower(c);};
-    auto first = begin();
-    auto last = first;
-    auto rfirst = rbegin();
-    auto rlast = rfirst;
-    associative_container map;
-    word_distribution distribution;
-    std::string w;
-    while (last < end()) {
-        first = std::find_if_not(last, end(), finder);
-        last = std::find_if(first, end(), finder);
-        if (first < last) {
-            first = std::find_if_not(first, last, punct);
-            rfirst = std::reverse_iterator<decltype(last)>(last);
-            rlast = std::reverse_iterator<decltype(first)>(first);
-            rfirst = std::find_if_not(rfirst, rlast, punct);
-            last = rfirst.base();
-            if (first < last) {
-                w = std::string(first, last);
-                std::transform(std::begin(w), std::end(w), std::begin(w), low);
-                ++map[w];
-            }
-        }
+    distribution result = compute_distribution(minimum);
+    result.select_by_count(k);
+    return result.to_pairs();
+}
+
+// Computes the distribution of the lowercase words of the article counted at
+// least the minimum number of times, in no given order, counting them in
+// place in an open-addressing table whose storage is kept from one article
+// to the next
+distribution
+article::
+compute_distribution(std::size_t minimum)
+{
+    distribution result;
+    compute_distribution(result, minimum);
+    return result;
+}
+
+// Computes the distribution of the lowercase words of the article counted at
+// least the minimum number of times into an existing distribution, reusing
+// its storage
+void
+article::
+compute_distribution(distribution& result, std::size_t minimum)
+{
+    _counter.clear();
+    for (auto&& token: tokenizer(view())) {
+        _counter.add(token);
     }
-    distribution.reserve(map.size());
-    for (auto it = std::begin(map); it != std::end(map); ++it) {
-        distribution.emplace_back(*it);
+    _counter.to_distribution(result, minimum);
+}
+
+// Computes the distribution of the lowercase words of the article counted at
+// least the minimum number of times, keyed by their identifiers in a shared
+// vocabulary, in no given order
+article::id_distribution
+article::
+compute_id_distribution(vocabulary& words, std::size_t minimum)
+{
+    id_distribution result;
+    compute_id_distribution(result, words, minimum);
+    return result;
+}
+
+// Computes the distribution of the lowercase words of the article counted at
+// least the minimum number of times into an existing distribution, keyed by
+// their identifiers in a shared vocabulary that may be filled by several
+// threads at once, each distinct word of the article being looked up once
+void
+article::
+compute_id_distribution(id_distribution& result, vocabulary& words,
+                        std::size_t minimum)
+{
+    _counter.clear();
+    for (auto&& token: tokenizer(view())) {
+        _counter.add(token);
+    }
+    _counter.to_ids(result, words, minimum);
+}
+
+// Computes the distribution of the lowercase sequences of n consecutive words
+// of the article counted at least the minimum number of times, in no given
+// order, each sequence being spelled with single spaces between the words
+distribution
+article::
+compute_ngram_distribution(size_type n, std::size_t minimum)
+{
+    distribution result;
+    compute_ngram_distribution(result, n, minimum);
+    return result;
+}
+
+// Computes the distribution of the lowercase sequences of n consecutive words
+// of the article counted at least the minimum number of times into an
+// existing distribution, the sequences being counted as identifiers of words
+// under a rolling hash and spelled out only when exported
+void
+article::
+compute_ngram_distribution(distribution& d, size_type n, std::size_t minimum)
+{
+    if (_ngrams.order() != n) {
+        _ngrams = ngram_counter(n);
+    }
+    _ngrams.clear();
+    for (auto&& token: tokenizer(view())) {
+        _ngrams.add(token);
+    }
+    _ngrams.to_distribution(d, minimum);
+}
+
+// Computes the distribution of the terms of a compiled matcher found at least
+// the minimum number of times in the article, in the order of their first
+// occurrence
+article::term_distribution
+article::
+compute_term_distribution(const term_matcher& terms, std::size_t minimum)
+{
+    term_distribution result;
+    compute_term_distribution(result, terms, minimum);
+    return result;
+}
+
+// Computes the distribution of the terms of a compiled matcher found at least
+// the minimum number of times in the article into an existing distribution,
+// in a single pass over the text that only counts dictionary terms, in an
+// array indexed by term and kept zeroed from one article to the next, the
+// threshold being applied to the terms found once the text is read
+void
+article::
+compute_term_distribution(term_distribution& result, const term_matcher& terms,
+                          std::size_t minimum)
+{
+    if (_term_counts.size() < terms.size()) {
+        _term_counts.resize(terms.size(), 0);
+    }
+    result.clear();
+    _terms.clear();
+    terms.match(view(), [this](term_type id){
+        if (_term_counts[id]++ == 0) {
+            _terms.push_back(id);
+        }
+    });
+    for (auto&& id: _terms) {
+        if (_term_counts[id] >= minimum) {
+            result.emplace_back(id, _term_counts[id]);
+        }
+        _term_counts[id] = 0;
     }
-    std::sort(std::begin(distribution), std::end(distribution), sorter);
-    return distribution;
 }
 // -------------------------------------------------------------------------- //
 
@@ -275,7 +506,38 @@ compute_word_distribution()
 std::ostream& 
 operator<<(std::ostream &os, const article& a)
 {
-    return os << a._text;
+    return os << a.view();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- ARTICLE: VALIDATION -------------------------- //
+// Replaces a mapping of nxml markup by the text of the sections selected by
+// the extractor, plain text nxml files being kept as they are
+void
+article::
+_extract()
+{
+    const string_view markup = _map.view();
+    if (_file.extension() == ".nxml" && nxml_extractor::is_markup(markup)) {
+        _extractor.extract(markup, _text);
+        _map.close();
+        utf8_repair(_text);
+    }
+}
+
+// Falls back to a repaired copy of the text if the mapping is not valid utf-8
+void
+article::
+_validate()
+{
+    const char* last = _map.data() + _map.size();
+    if (utf8_validate(_map.data(), last) != last) {
+        _text.assign(_map.data(), _map.size());
+        _map.close();
+        utf8_repair(_text);
+    }
 }
 // -------------------------------------------------------------------------- //
 
@@ -0,0 +1,451 @@
+// ============================== BATCH DRIVER ============================== //
+// Project:         epidemium_oncobase
+// Name:            batch_driver.hpp
+// Description:     Splits articles in shards checkpointed for resumed runs
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * batch_driver.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _BATCH_DRIVER_HPP_INCLUDED
+#define _BATCH_DRIVER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+#include <experimental/filesystem>
+// Include others
+#include "memory_map.hpp"
+#include "buffered_writer.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ****************************** BATCH DRIVER ****************************** */
+// Batch driver class definition
+class batch_driver
+{
+    // Types
+    public:
+    using size_type = std::size_t;
+    using hash_type = std::uint64_t;
+    using iterator = std::vector<std::string>::const_iterator;
+    using clock_type = std::chrono::steady_clock;
+    using duration_type = clock_type::duration;
+
+    // Constants
+    public:
+    static constexpr size_type shard = 1 << 10;
+    static constexpr size_type interval = 1 << 6;
+    static constexpr size_type period = 30;
+    static constexpr const char* magic = "ONCOCHK2";
+    static constexpr size_type magic_size = 8;
+
+    // Lifecycle
+    public:
+    explicit batch_driver(const std::string& directory = "",
+                          size_type nshard = shard,
+                          size_type ninterval = interval,
+                          duration_type delay
+                          = std::chrono::seconds(size_type(period)));
+
+    // Access
+    public:
+    const std::string& directory() const noexcept;
+    size_type shard_size() const noexcept;
+    size_type shard_count() const noexcept;
+    size_type completed_count() const noexcept;
+    size_type resumed_count() const noexcept;
+    std::string path(hash_type fingerprint) const;
+
+    // Processing
+    public:
+    template <class I, class F, class G>
+    void run(I first, I last, F&& process, G&& resume);
+    template <class F, class G>
+    void finish(F&& process, G&& resume);
+
+    // Checkpoint
+    public:
+    bool load();
+    bool save() const;
+
+    // Implementation details: shards
+    private:
+    static hash_type _hash(const std::string& item) noexcept;
+    static hash_type _fingerprint(iterator first, iterator last);
+    template <class F, class G>
+    void _run(F&& process, G&& resume);
+    void _prune();
+
+    // Implementation details: data members
+    private:
+    std::string _directory;
+    size_type _size;
+    size_type _interval;
+    duration_type _delay;
+    std::vector<std::string> _items;
+    std::vector<hash_type> _completed;
+    std::vector<hash_type> _referenced;
+    size_type _shards;
+    size_type _resumed;
+    size_type _unsaved;
+    clock_type::time_point _saved;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------ BATCH DRIVER: LIFECYCLE ------------------------- //
+// Constructs a driver cutting shards of the given number of items on
+// average, keeping its checkpoint and the partial results of the shards in a
+// directory, or nowhere if the directory is empty, and saving the checkpoint
+// once the given number of shards have been completed since the last save or
+// once the given delay has elapsed since then, whichever comes first
+batch_driver::
+batch_driver(const std::string& directory, size_type nshard,
+             size_type ninterval, duration_type delay)
+: _directory(directory)
+, _size(std::max(nshard, size_type(1)))
+, _interval(std::max(ninterval, size_type(1)))
+, _delay(delay)
+, _items()
+, _completed()
+, _referenced()
+, _shards(0)
+, _resumed(0)
+, _unsaved(0)
+, _saved(clock_type::now())
+{
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- BATCH DRIVER: ACCESS -------------------------- //
+// Returns the directory of the checkpoint and of the partial results
+const std::string&
+batch_driver::
+directory()
+const noexcept
+{
+    return _directory;
+}
+
+// Returns the average number of items of a shard
+batch_driver::size_type
+batch_driver::
+shard_size()
+const noexcept
+{
+    return _size;
+}
+
+// Returns the number of shards processed or resumed so far
+batch_driver::size_type
+batch_driver::
+shard_count()
+const noexcept
+{
+    return _shards;
+}
+
+// Returns the number of shards recorded as completed in the checkpoint
+batch_driver::size_type
+batch_driver::
+completed_count()
+const noexcept
+{
+    return _completed.size();
+}
+
+// Returns the number of shards whose partial results have been read back
+// instead of being processed again
+batch_driver::size_type
+batch_driver::
+resumed_count()
+const noexcept
+{
+    return _resumed;
+}
+
+// Returns the file of the partial results of the shard of a fingerprint, or
+// an empty string if the driver keeps nothing on disk
+std::string
+batch_driver::
+path(hash_type fingerprint)
+const
+{
+    static constexpr const char* digits = "0123456789abcdef";
+    std::string name(sizeof(hash_type) * 2, '0');
+    for (size_type k = name.size(); k > 0; fingerprint >>= 4) {
+        name[--k] = digits[fingerprint & 0xF];
+    }
+    return _directory.size()
+         ? _directory + "/shard_" + name + ".bin"
+         : std::string();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ BATCH DRIVER: PROCESSING ------------------------ //
+// Appends items to the current shard and runs it after each item whose hash
+// is a multiple of the shard size, or once it reaches four times that size,
+// so that adding or removing an item only changes the shard holding it:
+// the resume function is called with the index, the items and the file of
+// the shard if a shard with the same items is recorded as completed, and the
+// process function with the same arguments otherwise or if resuming fails,
+// a shard being recorded as completed in the checkpoint once it has been
+// processed and its partial results saved, both functions returning whether
+// they succeeded
+template <class I, class F, class G>
+void
+batch_driver::
+run(I first, I last, F&& process, G&& resume)
+{
+    for (; first != last; ++first) {
+        _items.push_back(std::string(*first));
+        if (_items.size() >= 4 * _size || _hash(_items.back()) % _size == 0) {
+            _run(process, resume);
+        }
+    }
+}
+
+// Runs the last shard, even if it is not full, then keeps in the checkpoint
+// only the shards of this run, saves it whatever the number of shards
+// completed since the last save, and removes the partial results of the
+// shards it no longer holds
+template <class F, class G>
+void
+batch_driver::
+finish(F&& process, G&& resume)
+{
+    if (_items.size()) {
+        _run(process, resume);
+    }
+    std::sort(_referenced.begin(), _referenced.end());
+    _referenced.erase(std::unique(_referenced.begin(), _referenced.end()),
+                      _referenced.end());
+    _completed.swap(_referenced);
+    _referenced.clear();
+    if (save()) {
+        _unsaved = 0;
+        _saved = clock_type::now();
+        _prune();
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ BATCH DRIVER: CHECKPOINT ------------------------ //
+// Loads the checkpoint from the directory, replacing the fingerprints of the
+// completed shards, and returns false if it is missing, corrupted or made for
+// other shard sizes
+bool
+batch_driver::
+load()
+{
+    memory_map map(_directory.size() ? _directory + "/checkpoint" : "");
+    const char* first = map.data();
+    const char* last = first + map.size();
+    std::vector<hash_type> completed;
+    std::uint64_t size = 0;
+    std::uint64_t count = 0;
+    bool good = map.size() >= magic_size;
+    auto read = [&](void* data, size_type n){
+        good = good && n <= static_cast<size_type>(last - first);
+        if (good) {
+            std::memcpy(data, first, n);
+            first += n;
+        }
+        return good;
+    };
+    good = good && std::memcmp(first, magic, magic_size) == 0;
+    first += good ? magic_size : 0;
+    read(&size, sizeof(size));
+    read(&count, sizeof(count));
+    good = good && size == _size;
+    good = good && count <= (last - first) / sizeof(hash_type);
+    if (good) {
+        completed.resize(count);
+        read(completed.data(), count * sizeof(hash_type));
+    }
+    if (good) {
+        std::sort(completed.begin(), completed.end());
+        _completed = std::move(completed);
+    }
+    return good;
+}
+
+// Saves the checkpoint to a temporary file renamed in place once complete and
+// synchronized, so that a checkpoint on disk is always a whole one, and
+// returns false if the driver keeps nothing on disk or if the file cannot be
+// written
+bool
+batch_driver::
+save()
+const
+{
+    buffered_writer stream;
+    std::uint64_t size = _size;
+    std::uint64_t count = _completed.size();
+    bool good = _directory.size();
+    auto write = [&](const void* data, size_type length){
+        stream.write(static_cast<const char*>(data), length);
+    };
+    if (good) {
+        stream.open(_directory + "/checkpoint");
+        write(magic, magic_size);
+        write(&size, sizeof(size));
+        write(&count, sizeof(count));
+        write(_completed.data(), count * sizeof(hash_type));
+        good = stream.commit();
+    }
+    return good;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- BATCH DRIVER: SHARDS -------------------------- //
+// Hashes an item to decide where shards end, the bits of the hash being
+// mixed so that its remainders are evenly spread
+batch_driver::hash_type
+batch_driver::
+_hash(const std::string& item)
+noexcept
+{
+    hash_type result = 14695981039346656037ULL;
+    for (auto&& c: item) {
+        result ^= static_cast<unsigned char>(c);
+        result *= 1099511628211ULL;
+    }
+    result ^= result >> 29;
+    result *= 0xBF58476D1CE4E5B9ULL;
+    return result ^ (result >> 32);
+}
+
+// Hashes the items of a shard, never returning zero
+batch_driver::hash_type
+batch_driver::
+_fingerprint(iterator first, iterator last)
+{
+    hash_type result = 14695981039346656037ULL;
+    for (; first != last; ++first) {
+        for (auto&& c: *first) {
+            result ^= static_cast<unsigned char>(c);
+            result *= 1099511628211ULL;
+        }
+        result ^= first->size();
+        result *= 1099511628211ULL;
+    }
+    return result | 1;
+}
+
+// Resumes or processes the current shard, the shards being known by the
+// fingerprint of their items rather than by their position so that the
+// order in which the shards come does not matter, records it in the
+// checkpoint once processed, saving the checkpoint only every few shards or
+// seconds so that the cost of the saves stays linear in the number of
+// shards, and empties it
+template <class F, class G>
+void
+batch_driver::
+_run(F&& process, G&& resume)
+{
+    const size_type k = _shards++;
+    const hash_type h = _fingerprint(_items.cbegin(), _items.cend());
+    const std::string filename = path(h);
+    auto position = std::lower_bound(_completed.begin(), _completed.end(), h);
+    const bool completed = position != _completed.end() && *position == h;
+    if (completed && resume(k, _items.cbegin(), _items.cend(), filename)) {
+        _referenced.push_back(h);
+        ++_resumed;
+    } else if (process(k, _items.cbegin(), _items.cend(), filename)) {
+        _referenced.push_back(h);
+        if (filename.size() && !completed) {
+            _completed.insert(position, h);
+            ++_unsaved;
+        }
+    }
+    if (_unsaved && (_unsaved >= _interval
+                 || clock_type::now() - _saved >= _delay)) {
+        save();
+        _unsaved = 0;
+        _saved = clock_type::now();
+    }
+    _items.clear();
+}
+
+// Removes the partial results of the shards that are not recorded as
+// completed, left over by earlier runs over items that have since changed
+void
+batch_driver::
+_prune()
+{
+    namespace filesystem = std::experimental::filesystem;
+    static constexpr const char* prefix = "shard_";
+    static constexpr const char* suffix = ".bin";
+    static constexpr size_type digits = sizeof(hash_type) * 2;
+    static constexpr size_type length = 6 + digits + 4;
+    std::vector<filesystem::path> stale;
+    std::error_code error;
+    std::string name;
+    char* end = nullptr;
+    hash_type h = 0;
+    for (filesystem::directory_iterator it(_directory, error), last;
+         !error && it != last; it.increment(error)) {
+        name = it->path().filename().string();
+        if (name.size() == length && name.compare(0, 6, prefix) == 0
+        &&  name.compare(6 + digits, 4, suffix) == 0) {
+            h = std::strtoull(name.c_str() + 6, &end, 16);
+            if (end == name.c_str() + 6 + digits
+            &&  !std::binary_search(_completed.begin(), _completed.end(), h)) {
+                stale.push_back(it->path());
+            }
+        }
+    }
+    for (auto&& p: stale) {
+        filesystem::remove(p, error);
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _BATCH_DRIVER_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,246 @@
+// ============================= BOUNDED QUEUE ============================== //
+// Project:         epidemium_oncobase
+// Name:            bounded_queue.hpp
+// Description:     A lock-free queue of fixed capacity shared by threads
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * bounded_queue.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _BOUNDED_QUEUE_HPP_INCLUDED
+#define _BOUNDED_QUEUE_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+// Include others
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ***************************** BOUNDED QUEUE ****************************** */
+// Bounded queue class definition
+template <class T>
+class bounded_queue
+{
+    // Types
+    public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    // Constants
+    public:
+    static constexpr size_type line = 64;
+
+    // Lifecycle
+    public:
+    explicit bounded_queue(size_type ncapacity = 1);
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    // Access
+    public:
+    size_type capacity() const noexcept;
+    size_type size() const noexcept;
+    bool empty() const noexcept;
+
+    // Operations
+    public:
+    template <class U>
+    bool try_push(U&& value);
+    bool try_pop(T& value);
+
+    // Implementation details: cells
+    private:
+    struct cell
+    {
+        std::atomic<size_type> sequence;
+        T value;
+    };
+
+    // Implementation details: data members
+    private:
+    std::vector<cell> _cells;
+    size_type _mask;
+    char _padding0[line];
+    std::atomic<size_type> _tail;
+    char _padding1[line];
+    std::atomic<size_type> _head;
+    char _padding2[line];
+};
+/* ************************************************************************** */
+
+
+
+// ----------------------- BOUNDED QUEUE: LIFECYCLE ------------------------- //
+// Constructs an empty queue holding at least the given number of elements,
+// rounded up to a power of two
+template <class T>
+bounded_queue<T>::
+bounded_queue(size_type ncapacity)
+: _cells()
+, _mask(1)
+, _padding0()
+, _tail(0)
+, _padding1()
+, _head(0)
+, _padding2()
+{
+    while (_mask < ncapacity) {
+        _mask <<= 1;
+    }
+    _cells = std::vector<cell>(_mask);
+    for (size_type k = 0; k < _mask; ++k) {
+        _cells[k].sequence.store(k, std::memory_order_relaxed);
+    }
+    --_mask;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- BOUNDED QUEUE: ACCESS -------------------------- //
+// Returns the maximal number of elements
+template <class T>
+typename bounded_queue<T>::size_type
+bounded_queue<T>::
+capacity()
+const noexcept
+{
+    return _mask + 1;
+}
+
+// Returns the number of elements, which is only a snapshot while other
+// threads push or pop
+template <class T>
+typename bounded_queue<T>::size_type
+bounded_queue<T>::
+size()
+const noexcept
+{
+    const size_type head = _head.load(std::memory_order_relaxed);
+    const size_type tail = _tail.load(std::memory_order_relaxed);
+    return tail > head ? std::min(tail - head, _mask + 1) : 0;
+}
+
+// Checks whether the queue is empty, which is only a snapshot while other
+// threads push or pop
+template <class T>
+bool
+bounded_queue<T>::
+empty()
+const noexcept
+{
+    return size() == 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------- BOUNDED QUEUE: OPERATIONS ------------------------ //
+// Appends an element without waiting and returns false if the queue is full,
+// any number of threads pushing and popping concurrently: each cell carries
+// a sequence number telling whether it is free for the push of a given
+// position or filled for the pop of that position, and positions are claimed
+// by a compare and swap
+template <class T>
+template <class U>
+bool
+bounded_queue<T>::
+try_push(U&& value)
+{
+    size_type position = _tail.load(std::memory_order_relaxed);
+    size_type sequence = 0;
+    cell* current = nullptr;
+    bool full = false;
+    while (!current && !full) {
+        current = &_cells[position & _mask];
+        sequence = current->sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (!_tail.compare_exchange_weak(position, position + 1,
+                                             std::memory_order_relaxed)) {
+                current = nullptr;
+            }
+        } else if (sequence < position) {
+            current = nullptr;
+            full = true;
+        } else {
+            current = nullptr;
+            position = _tail.load(std::memory_order_relaxed);
+        }
+    }
+    if (current) {
+        current->value = std::forward<U>(value);
+        current->sequence.store(position + 1, std::memory_order_release);
+    }
+    return current != nullptr;
+}
+
+// Removes the first element without waiting and returns false if the queue
+// is empty, any number of threads pushing and popping concurrently
+template <class T>
+bool
+bounded_queue<T>::
+try_pop(T& value)
+{
+    size_type position = _head.load(std::memory_order_relaxed);
+    size_type sequence = 0;
+    cell* current = nullptr;
+    bool empty = false;
+    while (!current && !empty) {
+        current = &_cells[position & _mask];
+        sequence = current->sequence.load(std::memory_order_acquire);
+        if (sequence == position + 1) {
+            if (!_head.compare_exchange_weak(position, position + 1,
+                                             std::memory_order_relaxed)) {
+                current = nullptr;
+            }
+        } else if (sequence < position + 1) {
+            current = nullptr;
+            empty = true;
+        } else {
+            current = nullptr;
+            position = _head.load(std::memory_order_relaxed);
+        }
+    }
+    if (current) {
+        value = std::move(current->value);
+        current->sequence.store(position + _mask + 1,
+                                std::memory_order_release);
+    }
+    return current != nullptr;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _BOUNDED_QUEUE_HPP_INCLUDED
+// ========================================================================== //
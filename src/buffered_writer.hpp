@@ -0,0 +1,564 @@
+// ============================ BUFFERED WRITER ============================= //
+// Project:         epidemium_oncobase
+// Name:            buffered_writer.hpp
+// Description:     A buffered writer replacing files atomically once complete
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * buffered_writer.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _BUFFERED_WRITER_HPP_INCLUDED
+#define _BUFFERED_WRITER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+// Include others
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "string_view.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* **************************** BUFFERED WRITER ***************************** */
+// Buffered writer class definition
+class buffered_writer
+{
+    // Types
+    public:
+    using value_type = char;
+    using size_type = std::size_t;
+    using buffer_type = std::vector<value_type>;
+    enum class sync_type {none, data, full};
+
+    // Constants
+    public:
+    static constexpr size_type buffer = 1 << 20;
+
+    // Lifecycle
+    public:
+    buffered_writer() noexcept;
+    buffered_writer(buffered_writer&& other) noexcept;
+    explicit buffered_writer(const std::string& filename,
+                             sync_type policy = sync_type::data,
+                             size_type nbuffer = buffer);
+    explicit buffered_writer(int descriptor, size_type nbuffer = buffer);
+    ~buffered_writer();
+
+    // Assignment
+    public:
+    buffered_writer& operator=(buffered_writer&& other) noexcept;
+
+    // Access
+    public:
+    size_type size() const noexcept;
+    size_type buffer_size() const noexcept;
+    sync_type policy() const noexcept;
+    bool is_open() const noexcept;
+    bool good() const noexcept;
+
+    // Writing
+    public:
+    buffered_writer& write(const value_type* data, size_type count);
+    buffered_writer& operator<<(value_type c);
+    buffered_writer& operator<<(const value_type* str);
+    buffered_writer& operator<<(const std::string& str);
+    buffered_writer& operator<<(const string_view& str);
+    template <class T, class = typename std::enable_if<
+        std::is_integral<T>::value
+    >::type>
+    buffered_writer& operator<<(T value);
+
+    // Management
+    public:
+    void open(const std::string& filename, sync_type policy = sync_type::data);
+    void open(int descriptor);
+    bool flush();
+    bool commit();
+    void discard() noexcept;
+
+    // Implementation details: formatting
+    private:
+    void _integer(long long value, std::true_type);
+    void _integer(unsigned long long value, std::false_type);
+
+    // Implementation details: storage
+    private:
+    bool _drain(const value_type* data, size_type count);
+    static std::string _resolve(const std::string& filename);
+    static bool _sync_directory(const std::string& filename);
+
+    // Implementation details: data members
+    private:
+    buffer_type _buffer;
+    size_type _used;
+    size_type _size;
+    std::string _filename;
+    std::string _temporary;
+    sync_type _policy;
+    int _descriptor;
+    bool _owned;
+    bool _good;
+};
+/* ************************************************************************** */
+
+
+
+// ----------------------- BUFFERED WRITER: LIFECYCLE ----------------------- //
+// Constructs a writer without any destination
+buffered_writer::
+buffered_writer()
+noexcept
+: _buffer()
+, _used(0)
+, _size(0)
+, _filename()
+, _temporary()
+, _policy(sync_type::none)
+, _descriptor(-1)
+, _owned(false)
+, _good(false)
+{
+}
+
+// Constructs a writer by stealing the destination and buffer of another one
+buffered_writer::
+buffered_writer(buffered_writer&& other)
+noexcept
+: _buffer(std::move(other._buffer))
+, _used(other._used)
+, _size(other._size)
+, _filename(std::move(other._filename))
+, _temporary(std::move(other._temporary))
+, _policy(other._policy)
+, _descriptor(other._descriptor)
+, _owned(other._owned)
+, _good(other._good)
+{
+    other._used = 0;
+    other._size = 0;
+    other._descriptor = -1;
+    other._owned = false;
+    other._good = false;
+}
+
+// Constructs a writer to a temporary file replacing the given file on commit
+buffered_writer::
+buffered_writer(const std::string& filename, sync_type policy,
+                size_type nbuffer)
+: buffered_writer()
+{
+    _buffer.resize(std::max(nbuffer, size_type(1)));
+    open(filename, policy);
+}
+
+// Constructs a writer to an already open descriptor, left open at the end
+buffered_writer::
+buffered_writer(int descriptor, size_type nbuffer)
+: buffered_writer()
+{
+    _buffer.resize(std::max(nbuffer, size_type(1)));
+    open(descriptor);
+}
+
+// Flushes a descriptor, or discards a temporary file that was not committed
+buffered_writer::
+~buffered_writer()
+{
+    if (_owned) {
+        discard();
+    } else if (_descriptor >= 0) {
+        flush();
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- BUFFERED WRITER: ASSIGNMENT ----------------------- //
+// Releases the current destination and steals the one of another writer
+buffered_writer&
+buffered_writer::
+operator=(buffered_writer&& other)
+noexcept
+{
+    if (this != &other) {
+        if (_owned) {
+            discard();
+        } else if (_descriptor >= 0) {
+            flush();
+        }
+        std::swap(_buffer, other._buffer);
+        std::swap(_used, other._used);
+        std::swap(_size, other._size);
+        std::swap(_filename, other._filename);
+        std::swap(_temporary, other._temporary);
+        std::swap(_policy, other._policy);
+        std::swap(_descriptor, other._descriptor);
+        std::swap(_owned, other._owned);
+        std::swap(_good, other._good);
+    }
+    return *this;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ BUFFERED WRITER: ACCESS ------------------------- //
+// Returns the number of bytes written so far, buffered or not
+buffered_writer::size_type
+buffered_writer::
+size()
+const noexcept
+{
+    return _size;
+}
+
+// Returns the capacity of the buffer
+buffered_writer::size_type
+buffered_writer::
+buffer_size()
+const noexcept
+{
+    return _buffer.size();
+}
+
+// Returns the synchronization performed on commit
+buffered_writer::sync_type
+buffered_writer::
+policy()
+const noexcept
+{
+    return _policy;
+}
+
+// Checks whether the writer has a destination
+bool
+buffered_writer::
+is_open()
+const noexcept
+{
+    return _descriptor >= 0;
+}
+
+// Checks whether all the writes have succeeded so far
+bool
+buffered_writer::
+good()
+const noexcept
+{
+    return _good;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ BUFFERED WRITER: WRITING ------------------------ //
+// Appends characters to the buffer, writing large blocks directly
+buffered_writer&
+buffered_writer::
+write(const value_type* data, size_type count)
+{
+    if (_used + count > _buffer.size()) {
+        flush();
+    }
+    if (count >= _buffer.size()) {
+        _drain(data, count);
+    } else if (count) {
+        std::memcpy(_buffer.data() + _used, data, count);
+        _used += count;
+    }
+    _size += count;
+    return *this;
+}
+
+// Appends a character
+buffered_writer&
+buffered_writer::
+operator<<(value_type c)
+{
+    if (_used < _buffer.size()) {
+        _buffer[_used++] = c;
+        ++_size;
+    } else {
+        write(&c, 1);
+    }
+    return *this;
+}
+
+// Appends a null-terminated string
+buffered_writer&
+buffered_writer::
+operator<<(const value_type* str)
+{
+    return write(str, std::strlen(str));
+}
+
+// Appends a string
+buffered_writer&
+buffered_writer::
+operator<<(const std::string& str)
+{
+    return write(str.data(), str.size());
+}
+
+// Appends a string view
+buffered_writer&
+buffered_writer::
+operator<<(const string_view& str)
+{
+    return str.size() ? write(&*str.begin(), str.size()) : *this;
+}
+
+// Appends the decimal representation of an integer
+template <class T, class>
+buffered_writer&
+buffered_writer::
+operator<<(T value)
+{
+    _integer(value, std::is_signed<T>());
+    return *this;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- BUFFERED WRITER: MANAGEMENT ----------------------- //
+// Opens a temporary file which will replace the given file on commit, next to
+// the file its symbolic links lead to, if any, so that the links are kept,
+// and with the permissions of the file it replaces, if any, or the default
+// ones otherwise, the owner being the one of the current process
+void
+buffered_writer::
+open(const std::string& filename, sync_type policy)
+{
+    static std::atomic<unsigned long> counter(0);
+    const int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+    struct stat status = {};
+    if (_owned) {
+        discard();
+    } else if (_descriptor >= 0) {
+        flush();
+    }
+    _buffer.resize(_buffer.empty() ? buffer : _buffer.size());
+    _filename = _resolve(filename);
+    _temporary = _filename + ".tmp" + std::to_string(::getpid());
+    _temporary += "." + std::to_string(counter++);
+    _policy = policy;
+    _descriptor = ::open(_temporary.data(), flags, 0666);
+    if (_descriptor >= 0 && ::stat(_filename.data(), &status) == 0) {
+        ::fchmod(_descriptor, status.st_mode & 07777);
+    }
+    _owned = _descriptor >= 0;
+    _good = _owned;
+    _used = 0;
+    _size = 0;
+}
+
+// Uses an already open descriptor, without any atomicity nor synchronization
+void
+buffered_writer::
+open(int descriptor)
+{
+    if (_owned) {
+        discard();
+    } else if (_descriptor >= 0) {
+        flush();
+    }
+    _buffer.resize(_buffer.empty() ? buffer : _buffer.size());
+    _filename.clear();
+    _temporary.clear();
+    _policy = sync_type::none;
+    _descriptor = descriptor;
+    _owned = false;
+    _good = _descriptor >= 0;
+    _used = 0;
+    _size = 0;
+}
+
+// Writes the buffered characters to the destination
+bool
+buffered_writer::
+flush()
+{
+    if (_used) {
+        _drain(_buffer.data(), _used);
+        _used = 0;
+    }
+    return _good;
+}
+
+// Flushes the buffer and, for a temporary file, synchronizes it according to
+// the policy and renames it in place, so that the file is replaced at once
+bool
+buffered_writer::
+commit()
+{
+    flush();
+    if (_owned) {
+        if (_good && _policy != sync_type::none) {
+            _good = ::fsync(_descriptor) == 0;
+        }
+        _good = ::close(_descriptor) == 0 && _good;
+        _descriptor = -1;
+        _owned = false;
+        if (_good) {
+            _good = std::rename(_temporary.data(), _filename.data()) == 0;
+        }
+        if (!_good) {
+            std::remove(_temporary.data());
+        } else if (_policy == sync_type::full) {
+            _good = _sync_directory(_filename);
+        }
+    }
+    return _good;
+}
+
+// Drops the buffered characters and removes the temporary file, if any
+void
+buffered_writer::
+discard()
+noexcept
+{
+    if (_owned) {
+        ::close(_descriptor);
+        std::remove(_temporary.data());
+        _descriptor = -1;
+        _owned = false;
+    }
+    _used = 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- BUFFERED WRITER: FORMATTING ----------------------- //
+// Appends the decimal representation of a signed integer
+void
+buffered_writer::
+_integer(long long value, std::true_type)
+{
+    unsigned long long magnitude = value;
+    if (value < 0) {
+        *this << '-';
+        magnitude = 0ULL - magnitude;
+    }
+    _integer(magnitude, std::false_type());
+}
+
+// Appends the decimal representation of an unsigned integer
+void
+buffered_writer::
+_integer(unsigned long long value, std::false_type)
+{
+    value_type digits[24];
+    value_type* first = digits + sizeof(digits);
+    do {
+        *--first = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    write(first, digits + sizeof(digits) - first);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ BUFFERED WRITER: STORAGE ------------------------ //
+// Writes characters to the descriptor, retrying on partial writes
+bool
+buffered_writer::
+_drain(const value_type* data, size_type count)
+{
+    ssize_t n = 0;
+    while (_good && count) {
+        n = ::write(_descriptor, data, count);
+        if (n > 0) {
+            data += n;
+            count -= n;
+        } else if (n == 0 || errno != EINTR) {
+            _good = false;
+        }
+    }
+    return _good;
+}
+
+// Follows the symbolic links leading to a file, even dangling, a relative
+// link being read from the directory of the link, and stops after as many
+// links as the system allows in a path
+std::string
+buffered_writer::
+_resolve(const std::string& filename)
+{
+    std::string result = filename;
+    std::vector<char> target(1 << 12);
+    std::string::size_type slash = std::string::npos;
+    ssize_t n = ::readlink(result.data(), target.data(), target.size());
+    for (int k = 0; k < 40 && n > 0 && size_type(n) < target.size(); ++k) {
+        slash = result.rfind('/');
+        if (target[0] == '/' || slash == std::string::npos) {
+            result.assign(target.data(), n);
+        } else {
+            result.replace(slash + 1, std::string::npos, target.data(), n);
+        }
+        n = ::readlink(result.data(), target.data(), target.size());
+    }
+    return result;
+}
+
+// Synchronizes the directory containing a file, so that a rename persists
+bool
+buffered_writer::
+_sync_directory(const std::string& filename)
+{
+    const std::string::size_type slash = filename.rfind('/');
+    const std::string directory = slash == std::string::npos ? "."
+                                : slash == 0 ? "/"
+                                : filename.substr(0, slash);
+    int descriptor = ::open(directory.data(), O_RDONLY | O_CLOEXEC);
+    bool good = descriptor >= 0 && ::fsync(descriptor) == 0;
+    if (descriptor >= 0) {
+        ::close(descriptor);
+    }
+    return good;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _BUFFERED_WRITER_HPP_INCLUDED
+// ========================================================================== //
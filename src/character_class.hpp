@@ -0,0 +1,314 @@
+// ============================ CHARACTER CLASS ============================= //
+// Project:         epidemium_oncobase
+// Name:            character_class.hpp
+// Description:     Locale-independent vectorized character classification
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * character_class.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _CHARACTER_CLASS_HPP_INCLUDED
+#define _CHARACTER_CLASS_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <array>
+#include <cstddef>
+// Include others
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* **************************** CHARACTER CLASS ***************************** */
+// Character class definition
+class character_class
+{
+    // Types
+    public:
+    using value_type = char;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using mask_type = unsigned char;
+    using table_type = std::array<mask_type, 256>;
+
+    // Constants
+    public:
+    static constexpr mask_type space = 1;
+    static constexpr mask_type control = 2;
+    static constexpr mask_type punctuation = 4;
+    static constexpr mask_type upper = 8;
+    static constexpr mask_type lower = 16;
+    static constexpr mask_type digit = 32;
+    static constexpr mask_type graph = 64;
+    static constexpr mask_type separator = space | control;
+
+    // Classification
+    public:
+    static const table_type& table();
+    static bool is(value_type c, mask_type mask);
+    static value_type to_lower(value_type c);
+
+    // Searching
+    public:
+    static const_pointer find_separator(const_pointer first,
+                                        const_pointer last);
+    static const_pointer find_non_separator(const_pointer first,
+                                            const_pointer last);
+    static const_pointer find_graph(const_pointer first, const_pointer last);
+    static const_pointer find_non_graph(const_pointer first,
+                                        const_pointer last);
+
+    // Conversion
+    public:
+    static void lowercase(const_pointer first, const_pointer last,
+                          pointer result);
+
+    // Implementation details: kernels
+    private:
+    template <mask_type M, bool B>
+    static const_pointer _find(const_pointer first, const_pointer last);
+};
+/* ************************************************************************** */
+
+
+
+// -------------------- CHARACTER CLASS: CLASSIFICATION --------------------- //
+// Returns the classes of the 256 byte values as in the classic locale, the
+// bytes outside of the ascii range belonging to no class
+const character_class::table_type&
+character_class::
+table()
+{
+    static const table_type classes = [](){
+        table_type result = {};
+        for (int c = 0; c < 128; ++c) {
+            result[c] |= (c >= '\t' && c <= '\r') || c == ' ' ? space : 0;
+            result[c] |= c < ' ' || c == 0x7F ? control : 0;
+            result[c] |= c >= 'A' && c <= 'Z' ? upper : 0;
+            result[c] |= c >= 'a' && c <= 'z' ? lower : 0;
+            result[c] |= c >= '0' && c <= '9' ? digit : 0;
+            result[c] |= c > ' ' && c < 0x7F ? graph : 0;
+            result[c] |= result[c] & (upper | lower | digit) ? 0
+                       : result[c] & graph ? punctuation : 0;
+        }
+        return result;
+    }();
+    return classes;
+}
+
+// Checks whether a character belongs to any of the classes of the mask
+bool
+character_class::
+is(value_type c, mask_type mask)
+{
+    return table()[static_cast<unsigned char>(c)] & mask;
+}
+
+// Converts an ascii uppercase letter to lowercase, leaving others unchanged
+character_class::value_type
+character_class::
+to_lower(value_type c)
+{
+    return static_cast<unsigned char>(c - 'A') < 26 ? c + ('a' - 'A') : c;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------- CHARACTER CLASS: SEARCHING ----------------------- //
+// Finds the first space or control character, or returns last
+character_class::const_pointer
+character_class::
+find_separator(const_pointer first, const_pointer last)
+{
+    return _find<separator, true>(first, last);
+}
+
+// Finds the first character that is neither a space nor a control character
+character_class::const_pointer
+character_class::
+find_non_separator(const_pointer first, const_pointer last)
+{
+    return _find<separator, false>(first, last);
+}
+
+// Finds the first printable character other than a space
+character_class::const_pointer
+character_class::
+find_graph(const_pointer first, const_pointer last)
+{
+    return _find<graph, true>(first, last);
+}
+
+// Finds the first character that is not printable or is a space
+character_class::const_pointer
+character_class::
+find_non_graph(const_pointer first, const_pointer last)
+{
+    return _find<graph, false>(first, last);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- CHARACTER CLASS: CONVERSION ----------------------- //
+// Copies characters converting ascii uppercase letters to lowercase, 32 or 16
+// bytes at a time when possible, result being allowed to equal first
+void
+character_class::
+lowercase(const_pointer first, const_pointer last, pointer result)
+{
+#if defined(__AVX2__)
+    const __m256i a = _mm256_set1_epi8('A' - 1);
+    const __m256i z = _mm256_set1_epi8('Z' + 1);
+    const __m256i shift = _mm256_set1_epi8('a' - 'A');
+    __m256i x;
+    while (last - first >= 32) {
+        x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        x = _mm256_add_epi8(x, _mm256_and_si256(shift, _mm256_and_si256(
+            _mm256_cmpgt_epi8(x, a), _mm256_cmpgt_epi8(z, x)
+        )));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(result), x);
+        first += 32;
+        result += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i a16 = _mm_set1_epi8('A' - 1);
+    const __m128i z16 = _mm_set1_epi8('Z' + 1);
+    const __m128i shift16 = _mm_set1_epi8('a' - 'A');
+    __m128i y;
+    while (last - first >= 16) {
+        y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        y = _mm_add_epi8(y, _mm_and_si128(shift16, _mm_and_si128(
+            _mm_cmpgt_epi8(y, a16), _mm_cmplt_epi8(y, z16)
+        )));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result), y);
+        first += 16;
+        result += 16;
+    }
+#endif
+    while (first < last) {
+        *result++ = to_lower(*first++);
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ CHARACTER CLASS: KERNELS ------------------------ //
+// Finds the first character whose membership of the separator or graph class
+// equals B: ascii blocks are classified 32 or 16 bytes at a time, while
+// blocks holding other bytes fall back to the table
+template <character_class::mask_type M, bool B>
+character_class::const_pointer
+character_class::
+_find(const_pointer first, const_pointer last)
+{
+    static_assert(M == separator || M == graph, "Unsupported class");
+    const table_type& classes = table();
+    auto found = [&classes](value_type c){
+        return static_cast<bool>(classes[static_cast<mask_type>(c)] & M) == B;
+    };
+    const_pointer block = first;
+    unsigned int bits = 0;
+#if defined(__AVX2__)
+    const __m256i space32 = _mm256_set1_epi8(' ');
+    const __m256i graph32 = _mm256_set1_epi8(' ' + 1);
+    const __m256i del32 = _mm256_set1_epi8(0x7F);
+    __m256i x;
+    __m256i m;
+    while (last - first >= 32) {
+        x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        if (_mm256_movemask_epi8(x) == 0) {
+            m = M == separator
+              ? _mm256_or_si256(_mm256_cmpgt_epi8(graph32, x),
+                                _mm256_cmpeq_epi8(x, del32))
+              : _mm256_and_si256(_mm256_cmpgt_epi8(x, space32),
+                                 _mm256_cmpgt_epi8(del32, x));
+            bits = _mm256_movemask_epi8(m);
+            bits = B ? bits : ~bits;
+            if (bits) {
+                return first + __builtin_ctz(bits);
+            }
+            first += 32;
+        } else {
+            for (block = first + 32; first < block; ++first) {
+                if (found(*first)) {
+                    return first;
+                }
+            }
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i space16 = _mm_set1_epi8(' ');
+    const __m128i graph16 = _mm_set1_epi8(' ' + 1);
+    const __m128i del16 = _mm_set1_epi8(0x7F);
+    __m128i y;
+    __m128i n;
+    while (last - first >= 16) {
+        y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        if (_mm_movemask_epi8(y) == 0) {
+            n = M == separator
+              ? _mm_or_si128(_mm_cmplt_epi8(y, graph16),
+                             _mm_cmpeq_epi8(y, del16))
+              : _mm_and_si128(_mm_cmpgt_epi8(y, space16),
+                              _mm_cmplt_epi8(y, del16));
+            bits = _mm_movemask_epi8(n);
+            bits = (B ? bits : ~bits) & 0xFFFF;
+            if (bits) {
+                return first + __builtin_ctz(bits);
+            }
+            first += 16;
+        } else {
+            for (block = first + 16; first < block; ++first) {
+                if (found(*first)) {
+                    return first;
+                }
+            }
+        }
+    }
+#endif
+    (void)(bits);
+    (void)(block);
+    while (first < last && !found(*first)) {
+        ++first;
+    }
+    return first;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _CHARACTER_CLASS_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,316 @@
+// ============================== CHUNK READER ============================== //
+// Project:         epidemium_oncobase
+// Name:            chunk_reader.hpp
+// Description:     A bounded-memory sequential reader of a file by chunks
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * chunk_reader.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _CHUNK_READER_HPP_INCLUDED
+#define _CHUNK_READER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+// Include others
+#include <fcntl.h>
+#include <unistd.h>
+#include "string_view.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ****************************** CHUNK READER ****************************** */
+// Chunk reader class definition
+class chunk_reader
+{
+    // Types
+    public:
+    using value_type = char;
+    using size_type = std::size_t;
+    using buffer_type = std::vector<value_type>;
+    using view_type = string_view;
+
+    // Constants
+    public:
+    static constexpr size_type chunk = 1 << 16;
+    static constexpr size_type overlap = 1 << 12;
+
+    // Lifecycle
+    public:
+    chunk_reader() noexcept;
+    chunk_reader(chunk_reader&& other) noexcept;
+    explicit chunk_reader(const std::string& filename, size_type nchunk = chunk,
+                          size_type noverlap = overlap);
+    ~chunk_reader();
+
+    // Assignment
+    public:
+    chunk_reader& operator=(chunk_reader&& other) noexcept;
+
+    // Access
+    public:
+    view_type view() const;
+    size_type position() const noexcept;
+    size_type chunk_size() const noexcept;
+    size_type overlap_size() const noexcept;
+    bool is_open() const noexcept;
+
+    // Management
+    public:
+    void open(const std::string& filename);
+    void close() noexcept;
+    bool next();
+    void carry(size_type count) noexcept;
+
+    // Implementation details: data members
+    private:
+    buffer_type _buffer;
+    size_type _chunk;
+    size_type _overlap;
+    size_type _size;
+    size_type _carry;
+    size_type _position;
+    int _descriptor;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------ CHUNK READER: LIFECYCLE ------------------------- //
+// Constructs a reader without any file
+chunk_reader::
+chunk_reader()
+noexcept
+: _buffer()
+, _chunk(chunk)
+, _overlap(overlap)
+, _size(0)
+, _carry(0)
+, _position(0)
+, _descriptor(-1)
+{
+}
+
+// Constructs a reader by stealing the file and the buffer of another reader
+chunk_reader::
+chunk_reader(chunk_reader&& other)
+noexcept
+: _buffer(std::move(other._buffer))
+, _chunk(other._chunk)
+, _overlap(other._overlap)
+, _size(other._size)
+, _carry(other._carry)
+, _position(other._position)
+, _descriptor(other._descriptor)
+{
+    other._size = 0;
+    other._carry = 0;
+    other._position = 0;
+    other._descriptor = -1;
+}
+
+// Constructs a reader of the given file, reading chunks of the given size and
+// keeping at most the given number of bytes from one chunk to the next
+chunk_reader::
+chunk_reader(const std::string& filename, size_type nchunk, size_type noverlap)
+: chunk_reader()
+{
+    _chunk = std::max(nchunk, size_type(1));
+    _overlap = noverlap;
+    open(filename);
+}
+
+// Closes the file
+chunk_reader::
+~chunk_reader()
+{
+    close();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ CHUNK READER: ASSIGNMENT ------------------------ //
+// Closes the current file and steals the file and buffer of another reader
+chunk_reader&
+chunk_reader::
+operator=(chunk_reader&& other)
+noexcept
+{
+    if (this != &other) {
+        close();
+        std::swap(_buffer, other._buffer);
+        std::swap(_chunk, other._chunk);
+        std::swap(_overlap, other._overlap);
+        std::swap(_size, other._size);
+        std::swap(_carry, other._carry);
+        std::swap(_position, other._position);
+        std::swap(_descriptor, other._descriptor);
+    }
+    return *this;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- CHUNK READER: ACCESS -------------------------- //
+// Returns a view over the carried bytes followed by the last chunk read
+chunk_reader::view_type
+chunk_reader::
+view()
+const
+{
+    return _size ? view_type(_buffer.data(), _size) : view_type();
+}
+
+// Returns the offset in the file of the first byte of the view
+chunk_reader::size_type
+chunk_reader::
+position()
+const noexcept
+{
+    return _position;
+}
+
+// Returns the maximal number of bytes read at once
+chunk_reader::size_type
+chunk_reader::
+chunk_size()
+const noexcept
+{
+    return _chunk;
+}
+
+// Returns the number of bytes that can be carried from one chunk to the next
+// without growing the buffer
+chunk_reader::size_type
+chunk_reader::
+overlap_size()
+const noexcept
+{
+    return _overlap;
+}
+
+// Checks whether a file is currently open
+bool
+chunk_reader::
+is_open()
+const noexcept
+{
+    return _descriptor >= 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ CHUNK READER: MANAGEMENT ------------------------ //
+// Opens a file for sequential reading, allocating the buffer only once for
+// all the chunks, and leaves the reader closed on failure
+void
+chunk_reader::
+open(const std::string& filename)
+{
+    close();
+    _descriptor = ::open(filename.data(), O_RDONLY | O_CLOEXEC);
+    if (_descriptor >= 0) {
+        ::posix_fadvise(_descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+        _buffer.resize(_chunk + _overlap);
+    }
+}
+
+// Closes the file and empties the view, keeping the buffer for reuse
+void
+chunk_reader::
+close()
+noexcept
+{
+    if (_descriptor >= 0) {
+        ::close(_descriptor);
+    }
+    _size = 0;
+    _carry = 0;
+    _position = 0;
+    _descriptor = -1;
+}
+
+// Reads the next chunk after the carried bytes and returns false once the
+// file is exhausted, in which case the view only holds the carried bytes
+bool
+chunk_reader::
+next()
+{
+    const size_type kept = std::min(_carry, _size);
+    char* data = nullptr;
+    size_type count = 0;
+    ssize_t n = 0;
+    if (_buffer.size() < _chunk + _overlap) {
+        _buffer.resize(_chunk + _overlap);
+    }
+    data = _buffer.data();
+    if (kept) {
+        std::memmove(data, data + _size - kept, kept);
+    }
+    _position += _size - kept;
+    _size = kept;
+    _carry = 0;
+    while (_descriptor >= 0 && count < _chunk) {
+        n = ::read(_descriptor, data + kept + count, _chunk - count);
+        if (n > 0) {
+            count += n;
+        } else if (n == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    _size += count;
+    return count > 0;
+}
+
+// Keeps the given number of trailing bytes of the view, up to the whole view,
+// at the beginning of the next one, the overlap growing to hold them if they
+// do not fit so that no carried byte is ever dropped
+void
+chunk_reader::
+carry(size_type count)
+noexcept
+{
+    _carry = std::min(count, _size);
+    _overlap = std::max(_overlap, _carry);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _CHUNK_READER_HPP_INCLUDED
+// ========================================================================== //
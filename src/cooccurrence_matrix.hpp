@@ -0,0 +1,367 @@
+// ========================== COOCCURRENCE MATRIX =========================== //
+// Project:         epidemium_oncobase
+// Name:            cooccurrence_matrix.hpp
+// Description:     Counts of the articles where pairs of terms occur together
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * cooccurrence_matrix.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _COOCCURRENCE_MATRIX_HPP_INCLUDED
+#define _COOCCURRENCE_MATRIX_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+// Include others
+#include "table.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ************************** COOCCURRENCE MATRIX *************************** */
+// Cooccurrence matrix class definition
+class cooccurrence_matrix
+{
+    // Types
+    public:
+    using size_type = std::size_t;
+    using id_type = std::uint32_t;
+    using count_type = std::uint32_t;
+    using block_type = std::uint64_t;
+
+    // Constants
+    public:
+    static constexpr size_type block = sizeof(block_type) * 8;
+
+    // Lifecycle
+    public:
+    explicit cooccurrence_matrix(size_type nterms = 0);
+
+    // Access
+    public:
+    size_type size() const noexcept;
+    size_type article_count() const noexcept;
+    size_type memory() const noexcept;
+    count_type count(id_type i, id_type j) const;
+
+    // Counting
+    public:
+    void insert(id_type id);
+    void commit();
+    void merge(const cooccurrence_matrix& other);
+
+    // Export
+    public:
+    table<count_type> to_table() const;
+    void to_table(table<count_type>& result) const;
+
+    // Management
+    public:
+    void resize(size_type nterms);
+    void clear() noexcept;
+
+    // Implementation details: kernels
+    private:
+    size_type _index(id_type i, id_type j) const noexcept;
+    block_type _mask() const noexcept;
+    void _accumulate(const cooccurrence_matrix& batch);
+    void _flush();
+
+    // Implementation details: data members
+    private:
+    std::vector<count_type> _counts;
+    std::vector<block_type> _columns;
+    std::vector<id_type> _present;
+    std::vector<id_type> _bounds;
+    std::vector<id_type> _touched;
+    size_type _size;
+    size_type _articles;
+};
+/* ************************************************************************** */
+
+
+
+// --------------------- COOCCURRENCE MATRIX: LIFECYCLE --------------------- //
+// Constructs a matrix for a number of terms, identified from 0 to that number
+cooccurrence_matrix::
+cooccurrence_matrix(size_type nterms)
+: _counts()
+, _columns()
+, _present()
+, _bounds()
+, _touched()
+, _size(0)
+, _articles(0)
+{
+    resize(nterms);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- COOCCURRENCE MATRIX: ACCESS ----------------------- //
+// Returns the number of terms
+cooccurrence_matrix::size_type
+cooccurrence_matrix::
+size()
+const noexcept
+{
+    return _size;
+}
+
+// Returns the number of committed articles
+cooccurrence_matrix::size_type
+cooccurrence_matrix::
+article_count()
+const noexcept
+{
+    return _articles;
+}
+
+// Returns the number of bytes held by the counts and the pending articles
+cooccurrence_matrix::size_type
+cooccurrence_matrix::
+memory()
+const noexcept
+{
+    return _counts.capacity() * sizeof(count_type)
+         + _columns.capacity() * sizeof(block_type)
+         + (_present.capacity() + _bounds.capacity() + _touched.capacity())
+         * sizeof(id_type);
+}
+
+// Returns the number of committed articles where both terms occur, or where
+// the term occurs if both are the same
+cooccurrence_matrix::count_type
+cooccurrence_matrix::
+count(id_type i, id_type j)
+const
+{
+    const block_type both = _columns.at(i) & _columns.at(j) & _mask();
+    return _counts[_index(i, j)] + __builtin_popcountll(both);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------- COOCCURRENCE MATRIX: COUNTING ---------------------- //
+// Marks a term as occurring in the current article, whatever the number of
+// times it is marked
+void
+cooccurrence_matrix::
+insert(id_type id)
+{
+    const block_type bit = block_type(1) << _bounds.size();
+    block_type& column = _columns[id];
+    if (!(column & bit)) {
+        if (!column) {
+            _touched.push_back(id);
+        }
+        column |= bit;
+        _present.push_back(id);
+    }
+}
+
+// Ends the current article, the pairs of its terms being counted once a block
+// of articles is complete
+void
+cooccurrence_matrix::
+commit()
+{
+    _bounds.push_back(static_cast<id_type>(_present.size()));
+    ++_articles;
+    if (_bounds.size() == block) {
+        _flush();
+    }
+}
+
+// Adds the counts and the committed articles of a matrix of the same size,
+// between articles
+void
+cooccurrence_matrix::
+merge(const cooccurrence_matrix& other)
+{
+    if (other._size == _size) {
+        for (size_type k = 0; k < _counts.size(); ++k) {
+            _counts[k] += other._counts[k];
+        }
+        _accumulate(other);
+        _articles += other._articles;
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- COOCCURRENCE MATRIX: EXPORT ----------------------- //
+// Exports the symmetric matrix of the counts as a table
+table<cooccurrence_matrix::count_type>
+cooccurrence_matrix::
+to_table()
+const
+{
+    table<count_type> result;
+    to_table(result);
+    return result;
+}
+
+// Exports the symmetric matrix of the counts into an existing table, reusing
+// its storage
+void
+cooccurrence_matrix::
+to_table(table<count_type>& result)
+const
+{
+    result.resize(_size, _size);
+    for (id_type i = 0; i < _size; ++i) {
+        for (id_type j = 0; j < _size; ++j) {
+            result.at(i, j) = count(i, j);
+        }
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------- COOCCURRENCE MATRIX: MANAGEMENT --------------------- //
+// Resizes the matrix to a number of terms and resets the counts
+void
+cooccurrence_matrix::
+resize(size_type nterms)
+{
+    _size = nterms;
+    _counts.assign(nterms * (nterms + 1) / 2, 0);
+    _columns.assign(nterms, 0);
+    _present.clear();
+    _bounds.clear();
+    _touched.clear();
+    _articles = 0;
+}
+
+// Resets the counts and drops the pending articles, keeping the storage
+void
+cooccurrence_matrix::
+clear()
+noexcept
+{
+    std::fill(_counts.begin(), _counts.end(), 0);
+    std::fill(_columns.begin(), _columns.end(), 0);
+    _present.clear();
+    _bounds.clear();
+    _touched.clear();
+    _articles = 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------- COOCCURRENCE MATRIX: KERNELS ---------------------- //
+// Returns the position of a pair of terms in the upper triangle of the counts
+cooccurrence_matrix::size_type
+cooccurrence_matrix::
+_index(id_type i, id_type j)
+const noexcept
+{
+    const size_type row = std::min(i, j);
+    return row * _size - row * (row - 1) / 2 + (std::max(i, j) - row);
+}
+
+// Returns the bits of the committed articles among the pending ones
+cooccurrence_matrix::block_type
+cooccurrence_matrix::
+_mask()
+const noexcept
+{
+    return _bounds.size() < block ? (block_type(1) << _bounds.size()) - 1
+                                  : ~block_type(0);
+}
+
+// Counts the pairs of terms of the committed pending articles of a matrix,
+// either pair by pair within each article when articles have few terms, or
+// by intersecting the article bits of each pair of terms when the same terms
+// keep occurring together, whichever takes fewer operations
+void
+cooccurrence_matrix::
+_accumulate(const cooccurrence_matrix& batch)
+{
+    const size_type touched = batch._touched.size();
+    const block_type mask = batch._mask();
+    const id_type* present = batch._present.data();
+    size_type sparse = 0;
+    size_type first = 0;
+    block_type column = 0;
+    id_type row = 0;
+    for (auto&& last: batch._bounds) {
+        sparse += (last - first) * (last - first + 1) / 2;
+        first = last;
+    }
+    if (sparse <= touched * (touched + 1) / 2) {
+        first = 0;
+        for (auto&& last: batch._bounds) {
+            for (size_type i = first; i < last; ++i) {
+                for (size_type j = i; j < last; ++j) {
+                    ++_counts[_index(present[i], present[j])];
+                }
+            }
+            first = last;
+        }
+    } else {
+        for (size_type i = 0; i < touched; ++i) {
+            row = batch._touched[i];
+            column = batch._columns[row] & mask;
+            for (size_type j = i; j < touched; ++j) {
+                _counts[_index(row, batch._touched[j])] += __builtin_popcountll(
+                    column & batch._columns[batch._touched[j]]
+                );
+            }
+        }
+    }
+}
+
+// Counts the pairs of terms of the pending articles and clears their bits
+void
+cooccurrence_matrix::
+_flush()
+{
+    _accumulate(*this);
+    for (auto&& id: _touched) {
+        _columns[id] = 0;
+    }
+    _present.clear();
+    _bounds.clear();
+    _touched.clear();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _COOCCURRENCE_MATRIX_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,530 @@
+// =============================== DATE PARSER ============================== //
+// Project:         epidemium_oncobase
+// Name:            date_parser.hpp
+// Description:     A memoized single-pass parser of free-form dates
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * date_parser.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _DATE_PARSER_HPP_INCLUDED
+#define _DATE_PARSER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <array>
+#include <ctime>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <string>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <experimental/filesystem>
+// Include others
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************* DATE PARSER ****************************** */
+// Date parser class definition
+class date_parser
+{
+    // Types
+    public:
+    using string_type = std::string;
+    using size_type = string_type::size_type;
+    using time_type = std::experimental::filesystem::file_time_type;
+    using fields_type = std::array<int, 4>;
+
+    // Constants
+    public:
+    static constexpr size_type capacity = 1 << 16;
+    static constexpr size_type npos = string_type::npos;
+
+    // Lifecycle
+    public:
+    explicit date_parser(size_type n = capacity);
+
+    // Parsing
+    public:
+    time_type operator()(const string_type& str);
+    std::tm parse(const string_type& str) const;
+
+    // Cache
+    public:
+    size_type cache_size() const noexcept;
+    void clear();
+
+    // Implementation details: scanning
+    private:
+    static bool _space(const string_type& t, size_type i);
+    static size_type _digits(const string_type& t, size_type i);
+    static size_type _spaces(const string_type& t, size_type i);
+    static int _number(const string_type& t, size_type i, size_type n);
+    static int _month(const string_type& t, size_type i);
+    static bool _meridiem(const string_type& t, size_type i, char c);
+    static size_type _ymdhp(const string_type& t, size_type i, char sep,
+                            fields_type& f);
+    static size_type _ymd(const string_type& t, size_type i, char sep,
+                          fields_type& f);
+    static size_type _dmy(const string_type& t, size_type i, char sep,
+                          fields_type& f);
+    static size_type _year(const string_type& t, size_type i, fields_type& f);
+    static size_type _ordinal(const string_type& t, size_type i,
+                              fields_type& f);
+    static size_type _day(const string_type& t, size_type i, fields_type& f);
+    static size_type _hms(const string_type& t, size_type i, fields_type& f);
+    static size_type _hm(const string_type& t, size_type i, fields_type& f);
+
+    // Implementation details: data members
+    private:
+    std::unordered_map<string_type, time_type> _cache;
+    size_type _capacity;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------- DATE PARSER: LIFECYCLE ------------------------- //
+// Constructs a parser remembering at most the given number of dates
+date_parser::
+date_parser(size_type n)
+: _cache()
+, _capacity(n)
+{
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- DATE PARSER: PARSING -------------------------- //
+// Converts a date string to a timestamp, reusing the previous conversions
+date_parser::time_type
+date_parser::
+operator()(const string_type& str)
+{
+    auto it = _cache.find(str);
+    std::tm time = std::tm();
+    time_type result;
+    if (it != _cache.end()) {
+        result = it->second;
+    } else {
+        time = parse(str);
+        result = time_type::clock::from_time_t(std::mktime(&time));
+        if (_cache.size() >= _capacity) {
+            _cache.clear();
+        }
+        if (_capacity) {
+            _cache.emplace(str, result);
+        }
+    }
+    return result;
+}
+
+// Parses a date in a single pass where each pattern keeps its own cursor, the
+// last match of each pattern winning before patterns are combined by priority
+std::tm
+date_parser::
+parse(const string_type& str)
+const
+{
+    constexpr size_type patterns = 11;
+    std::array<size_type, patterns> cursors = {};
+    std::array<fields_type, patterns> matches = {};
+    std::array<bool, patterns> found = {};
+    std::array<bool, 13> months = {};
+    fields_type f = {};
+    size_type i = 0;
+    string_type t(str);
+    std::tm time = std::tm();
+    bool pm = false;
+    bool am = false;
+    int year = -1;
+    int month = -1;
+    int day = -1;
+    int hour = -1;
+    int min = -1;
+    int sec = -1;
+    auto scan = [&](size_type p, size_type last){
+        if (last != npos) {
+            cursors[p] = last;
+            matches[p] = f;
+            found[p] = true;
+        }
+    };
+    for (auto&& c: t) {
+        c = std::tolower(static_cast<unsigned char>(c));
+    }
+    for (i = 0; i < t.size(); ++i) {
+        cursors[0] <= i ? scan(0, _ymdhp(t, i, '-', f)) : void();
+        cursors[1] <= i ? scan(1, _ymdhp(t, i, '/', f)) : void();
+        cursors[2] <= i ? scan(2, _ymd(t, i, '-', f)) : void();
+        cursors[3] <= i ? scan(3, _dmy(t, i, '-', f)) : void();
+        cursors[4] <= i ? scan(4, _dmy(t, i, '/', f)) : void();
+        cursors[5] <= i ? scan(5, _ymd(t, i, '/', f)) : void();
+        cursors[6] <= i ? scan(6, _year(t, i, f)) : void();
+        cursors[7] <= i ? scan(7, _ordinal(t, i, f)) : void();
+        cursors[8] <= i ? scan(8, _day(t, i, f)) : void();
+        cursors[9] <= i ? scan(9, _hms(t, i, f)) : void();
+        cursors[10] <= i ? scan(10, _hm(t, i, f)) : void();
+        months[_month(t, i)] = true;
+        pm = pm || _meridiem(t, i, 'p');
+        am = am || _meridiem(t, i, 'a');
+    }
+    if (t.size()) {
+        for (size_type p = 0; p < 2 && year < 0; ++p) {
+            if (found[p]) {
+                year = matches[p][0];
+                month = matches[p][1];
+                day = matches[p][2];
+                hour = matches[p][3];
+            }
+        }
+        for (size_type p = 2; p < 6 && year < 0; ++p) {
+            if (found[p]) {
+                year = matches[p][0];
+                month = matches[p][1];
+                day = matches[p][2];
+            }
+        }
+        if (month < 0) {
+            year = found[6] ? matches[6][0] : year;
+            for (int m = 1; m < 13 && month < 0; ++m) {
+                month = months[m] ? m : month;
+            }
+        }
+        if (month > 0 && day < 0 && found[7]) {
+            day = matches[7][0];
+        }
+        if (month > 0 && day < 0 && found[8]) {
+            day = matches[8][0];
+        }
+        if (hour < 0 && found[9]) {
+            hour = matches[9][0];
+            min = matches[9][1];
+            sec = matches[9][2];
+        }
+        if (hour < 0 && found[10]) {
+            hour = matches[10][0];
+            min = matches[10][1];
+        }
+        if (hour >= 0) {
+            if (pm && hour >= 1 && hour <= 11) {
+                hour += 12;
+            }
+            if (am && hour == 12) {
+                hour -= 12;
+            }
+        }
+        year >= 0 ? (time.tm_year = year - 1900) : time.tm_year;
+        month >= 0 ? (time.tm_mon = month - 1) : time.tm_mon;
+        day >= 0 ? (time.tm_mday = day) : time.tm_mday;
+        hour >= 0 ? (time.tm_hour = hour) : time.tm_hour;
+        min >= 0 ? (time.tm_min = min) : time.tm_min;
+        sec >= 0 ? (time.tm_sec = sec) : time.tm_sec;
+    }
+    return time;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- DATE PARSER: CACHE --------------------------- //
+// Returns the number of remembered dates
+date_parser::size_type
+date_parser::
+cache_size()
+const noexcept
+{
+    return _cache.size();
+}
+
+// Forgets all the remembered dates
+void
+date_parser::
+clear()
+{
+    _cache.clear();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- DATE PARSER: SCANNING -------------------------- //
+// Checks whether the character at the given position is a whitespace
+bool
+date_parser::
+_space(const string_type& t, size_type i)
+{
+    return i < t.size() && std::isspace(static_cast<unsigned char>(t[i]));
+}
+
+// Counts the consecutive digits starting at the given position
+date_parser::size_type
+date_parser::
+_digits(const string_type& t, size_type i)
+{
+    size_type n = 0;
+    while (i + n < t.size() && t[i + n] >= '0' && t[i + n] <= '9') {
+        ++n;
+    }
+    return n;
+}
+
+// Counts the consecutive whitespaces starting at the given position
+date_parser::size_type
+date_parser::
+_spaces(const string_type& t, size_type i)
+{
+    size_type n = 0;
+    while (_space(t, i + n)) {
+        ++n;
+    }
+    return n;
+}
+
+// Converts the given number of digits to an integer, wrapping like scanf does
+int
+date_parser::
+_number(const string_type& t, size_type i, size_type n)
+{
+    const unsigned long long limit = LONG_MAX;
+    unsigned long long result = 0;
+    for (size_type k = 0; k < n; ++k) {
+        result = std::min(result, limit / 10) * 10 + (t[i + k] - '0');
+        result = std::min(result, limit);
+    }
+    return static_cast<int>(static_cast<long>(result));
+}
+
+// Returns the month whose english or french name starts here, or zero
+int
+date_parser::
+_month(const string_type& t, size_type i)
+{
+    static const std::array<std::pair<const char*, int>, 18> names = {{
+        {"jan", 1}, {"feb", 2}, {"fev", 2}, {"mar", 3}, {"apr", 4},
+        {"avr", 4}, {"may", 5}, {"mai", 5}, {"jun", 6}, {"juin", 6},
+        {"jul", 7}, {"juil", 7}, {"aug", 8}, {"ao", 8}, {"sep", 9},
+        {"oct", 10}, {"nov", 11}, {"dec", 12}
+    }};
+    int month = 0;
+    for (auto&& name: names) {
+        if (t.compare(i, std::strlen(name.first), name.first) == 0) {
+            month = name.second;
+            break;
+        }
+    }
+    return month;
+}
+
+// Checks whether a number ending here is followed by an am or pm marker
+bool
+date_parser::
+_meridiem(const string_type& t, size_type i, char c)
+{
+    size_type j = i + 1;
+    bool result = _digits(t, i) == 1;
+    if (result) {
+        j += _spaces(t, j);
+        result = j + 1 < t.size() && t[j] == c && t[j + 1] == 'm';
+    }
+    return result;
+}
+
+// Matches year-month-day-hour-+-number with the given separator
+date_parser::size_type
+date_parser::
+_ymdhp(const string_type& t, size_type i, char sep, fields_type& f)
+{
+    size_type n = _digits(t, i);
+    size_type end = npos;
+    if (n == 4 && i + n < t.size() && t[i + n] == sep) {
+        f[0] = _number(t, i, n);
+        i += n + 1;
+        for (size_type k = 1; k < 4 && i != npos; ++k) {
+            n = _digits(t, i);
+            if (n && i + n < t.size() && t[i + n] == sep) {
+                f[k] = _number(t, i, n);
+                i += n + 1;
+            } else {
+                i = npos;
+            }
+        }
+        if (i != npos && i + 1 < t.size() && t[i] == '+' && t[i + 1] == sep) {
+            n = _digits(t, i + 2);
+            end = n ? i + 2 + n : npos;
+        }
+    }
+    return end;
+}
+
+// Matches year-month-day with the given separator
+date_parser::size_type
+date_parser::
+_ymd(const string_type& t, size_type i, char sep, fields_type& f)
+{
+    size_type n = _digits(t, i);
+    size_type end = npos;
+    if (n == 4 && i + n < t.size() && t[i + n] == sep) {
+        f[0] = _number(t, i, n);
+        i += n + 1;
+        n = _digits(t, i);
+        if (n && i + n < t.size() && t[i + n] == sep) {
+            f[1] = _number(t, i, n);
+            i += n + 1;
+            n = _digits(t, i);
+            f[2] = _number(t, i, n);
+            end = n ? i + n : npos;
+        }
+    }
+    return end;
+}
+
+// Matches day-month-year with the given separator and a four digit year
+date_parser::size_type
+date_parser::
+_dmy(const string_type& t, size_type i, char sep, fields_type& f)
+{
+    size_type n = _digits(t, i);
+    size_type end = npos;
+    if (n && i + n < t.size() && t[i + n] == sep) {
+        f[2] = _number(t, i, n);
+        i += n + 1;
+        n = _digits(t, i);
+        if (n && i + n < t.size() && t[i + n] == sep) {
+            f[1] = _number(t, i, n);
+            i += n + 1;
+            f[0] = _number(t, i, 4);
+            end = _digits(t, i) >= 4 ? i + 4 : npos;
+        }
+    }
+    return end;
+}
+
+// Matches a group of four digits
+date_parser::size_type
+date_parser::
+_year(const string_type& t, size_type i, fields_type& f)
+{
+    size_type end = npos;
+    if (_digits(t, i) >= 4) {
+        f[0] = _number(t, i, 4);
+        end = i + 4;
+    }
+    return end;
+}
+
+// Matches whitespaces followed by an ordinal day such as 1st or 22nd
+date_parser::size_type
+date_parser::
+_ordinal(const string_type& t, size_type i, fields_type& f)
+{
+    static const std::array<const char*, 4> suffixes = {"st", "nd", "rd", "th"};
+    size_type j = i + _spaces(t, i);
+    size_type n = std::min(_digits(t, j), size_type(2));
+    size_type end = npos;
+    if (j > i) {
+        for (; n > 0 && end == npos; --n) {
+            for (auto&& suffix: suffixes) {
+                if (t.compare(j + n, 2, suffix) == 0) {
+                    f[0] = _number(t, j, n);
+                    end = j + n;
+                }
+            }
+        }
+    }
+    return end;
+}
+
+// Matches whitespaces followed by a day of one or two digits and whitespaces
+// or a comma
+date_parser::size_type
+date_parser::
+_day(const string_type& t, size_type i, fields_type& f)
+{
+    size_type j = i + _spaces(t, i);
+    size_type n = _digits(t, j);
+    size_type end = npos;
+    if (j > i && n >= 1 && n <= 2) {
+        f[0] = _number(t, j, n);
+        if (_space(t, j + n)) {
+            end = j + n + _spaces(t, j + n);
+        } else if (j + n < t.size() && t[j + n] == ',') {
+            end = j + n + 1;
+        }
+    }
+    return end;
+}
+
+// Matches hours, minutes and seconds of one or two digits
+date_parser::size_type
+date_parser::
+_hms(const string_type& t, size_type i, fields_type& f)
+{
+    size_type n = _digits(t, i);
+    size_type end = npos;
+    if (n >= 1 && n <= 2 && i + n < t.size() && t[i + n] == ':') {
+        f[0] = _number(t, i, n);
+        i += n + 1;
+        n = _digits(t, i);
+        if (n >= 1 && n <= 2 && i + n < t.size() && t[i + n] == ':') {
+            f[1] = _number(t, i, n);
+            i += n + 1;
+            n = std::min(_digits(t, i), size_type(2));
+            f[2] = _number(t, i, n);
+            end = n ? i + n : npos;
+        }
+    }
+    return end;
+}
+
+// Matches hours and minutes of one or two digits
+date_parser::size_type
+date_parser::
+_hm(const string_type& t, size_type i, fields_type& f)
+{
+    size_type n = _digits(t, i);
+    size_type end = npos;
+    if (n >= 1 && n <= 2 && i + n < t.size() && t[i + n] == ':') {
+        f[0] = _number(t, i, n);
+        i += n + 1;
+        n = std::min(_digits(t, i), size_type(2));
+        f[1] = _number(t, i, n);
+        end = n ? i + n : npos;
+    }
+    return end;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _DATE_PARSER_HPP_INCLUDED
+// ========================================================================== //
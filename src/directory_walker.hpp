@@ -0,0 +1,469 @@
+// ============================ DIRECTORY WALKER ============================ //
+// Project:         epidemium_oncobase
+// Name:            directory_walker.hpp
+// Description:     A parallel walker streaming the contents of a directory
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * directory_walker.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _DIRECTORY_WALKER_HPP_INCLUDED
+#define _DIRECTORY_WALKER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <condition_variable>
+#include <experimental/filesystem>
+// Include others
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "file.hpp"
+#include "manifest.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* **************************** DIRECTORY WALKER **************************** */
+// Directory walker class definition
+class directory_walker
+{
+    // Types
+    public:
+    using path_type = std::experimental::filesystem::path;
+    using batch_type = std::vector<path_type>;
+    using file_batch_type = std::vector<file>;
+    using size_type = std::size_t;
+
+    // Constants
+    public:
+    static constexpr size_type batch = 1 << 10;
+
+    // Lifecycle
+    public:
+    explicit directory_walker(size_type nthreads = 0, size_type nbatch = batch,
+                              bool nordered = false);
+
+    // Access
+    public:
+    size_type thread_count() const noexcept;
+    size_type batch_size() const noexcept;
+    bool ordered() const noexcept;
+
+    // Walking
+    public:
+    template <class F, class G>
+    void walk(const path_type& root, F&& filter, G&& callback) const;
+    template <class F, class G>
+    void walk_files(const path_type& root, F&& filter, G&& callback) const;
+    template <class F, class G>
+    void walk_files(const path_type& root, F&& filter, G&& callback,
+                    manifest& m) const;
+
+    // Implementation details: walking
+    private:
+    template <class B, class V, class G>
+    void _walk(const path_type& root, V&& visit, G&& callback) const;
+    template <class B, class V, class G>
+    void _walk_in_order(const path_type& root, V&& visit, G&& callback) const;
+    template <class F>
+    static void _read(const path_type& directory, F&& f);
+    static const path_type& _path(const path_type& p) noexcept;
+    static path_type _path(const file& f);
+    
+    // Implementation details: data members
+    private:
+    size_type _threads;
+    size_type _batch;
+    bool _ordered;
+};
+/* ************************************************************************** */
+
+
+
+// ---------------------- DIRECTORY WALKER: LIFECYCLE ----------------------- //
+// Constructs a walker from a number of threads, zero meaning all the cores,
+// and whether the paths should come in an order that only depends on the tree
+directory_walker::
+directory_walker(size_type nthreads, size_type nbatch, bool nordered)
+: _threads(nthreads ? nthreads : std::thread::hardware_concurrency())
+, _batch(std::max(nbatch, size_type(1)))
+, _ordered(nordered)
+{
+    _threads = std::max(_threads, size_type(1));
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ DIRECTORY WALKER: ACCESS ------------------------ //
+// Returns the number of threads used to walk the directories
+directory_walker::size_type
+directory_walker::
+thread_count()
+const noexcept
+{
+    return _threads;
+}
+
+// Returns the maximal number of paths passed at once to the callback
+directory_walker::size_type
+directory_walker::
+batch_size()
+const noexcept
+{
+    return _batch;
+}
+
+// Checks whether the paths come sorted within each directory, the
+// directories being walked level by level in the order of their paths
+bool
+directory_walker::
+ordered()
+const noexcept
+{
+    return _ordered;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ DIRECTORY WALKER: WALKING ----------------------- //
+// Streams batches of the filtered paths to the callback during the walk: the
+// filter must be thread-safe while the callback is serialized by a lock
+template <class F, class G>
+void
+directory_walker::
+walk(const path_type& root, F&& filter, G&& callback)
+const
+{
+    auto visit = [&](const path_type& directory, batch_type& subdirectories,
+                     auto&& emit){
+        _read(directory, [&](int, const char*, path_type& p, bool is_dir){
+            if (is_dir) {
+                subdirectories.push_back(p);
+            }
+            if (filter(p)) {
+                emit(std::move(p));
+            }
+        });
+    };
+    _walk<batch_type>(root, visit, callback);
+}
+
+// Streams batches of the filtered files to the callback during the walk, with
+// their metadata fetched by a single call relative to the open directory
+template <class F, class G>
+void
+directory_walker::
+walk_files(const path_type& root, F&& filter, G&& callback)
+const
+{
+    auto visit = [&](const path_type& directory, batch_type& subdirectories,
+                     auto&& emit){
+        _read(directory, [&](int fd, const char* name, path_type& p,
+                             bool is_dir){
+            if (is_dir) {
+                subdirectories.push_back(p);
+            }
+            if (filter(p)) {
+                emit(file::make_at(fd, name, std::move(p)));
+            }
+        });
+    };
+    _walk<file_batch_type>(root, visit, callback);
+}
+
+// Streams batches of the filtered files to the callback during the walk,
+// serving the directories whose timestamp is unchanged from the manifest
+template <class F, class G>
+void
+directory_walker::
+walk_files(const path_type& root, F&& filter, G&& callback, manifest& m)
+const
+{
+    auto visit = [&](const path_type& directory, batch_type& subdirectories,
+                     auto&& emit){
+        file_batch_type entries;
+        batch_type children;
+        file::time_type time = file(directory).time();
+        if (m.find(directory, time, entries, children)) {
+            subdirectories.insert(subdirectories.end(), children.begin(),
+                                  children.end());
+        } else {
+            _read(directory, [&](int fd, const char* name, path_type& p,
+                                 bool is_dir){
+                if (is_dir) {
+                    subdirectories.push_back(p);
+                }
+                entries.push_back(file::make_at(fd, name, std::move(p)));
+            });
+            m.insert(directory, time, entries, subdirectories);
+        }
+        for (auto&& entry: entries) {
+            if (filter(entry.path())) {
+                emit(std::move(entry));
+            }
+        }
+    };
+    _walk<file_batch_type>(root, visit, callback);
+}
+
+// Walks the directories on several threads, the visitor listing the contents
+// of each directory and emitting the elements of the batches, in any order or
+// in the order of the tree if the walker is ordered
+template <class B, class V, class G>
+void
+directory_walker::
+_walk(const path_type& root, V&& visit, G&& callback)
+const
+{
+    std::deque<path_type> directories;
+    std::mutex directory_mutex;
+    std::mutex callback_mutex;
+    std::condition_variable condition;
+    std::vector<std::thread> threads;
+    size_type active = 0;
+    auto deliver = [&](B& batch){
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        callback(std::move(batch));
+        batch = B();
+    };
+    auto worker = [&](){
+        std::unique_lock<std::mutex> lock(directory_mutex, std::defer_lock);
+        batch_type subdirectories;
+        B batch;
+        path_type directory;
+        auto emit = [&](typename B::value_type&& element){
+            if (batch.empty()) {
+                batch.reserve(_batch);
+            }
+            batch.push_back(std::move(element));
+            if (batch.size() >= _batch) {
+                deliver(batch);
+            }
+        };
+        while (true) {
+            lock.lock();
+            condition.wait(lock, [&](){
+                return !directories.empty() || active == 0;
+            });
+            if (directories.empty()) {
+                break;
+            }
+            directory = std::move(directories.front());
+            directories.pop_front();
+            ++active;
+            lock.unlock();
+            visit(directory, subdirectories, emit);
+            lock.lock();
+            for (auto&& subdirectory: subdirectories) {
+                directories.push_back(std::move(subdirectory));
+            }
+            subdirectories.clear();
+            --active;
+            lock.unlock();
+            condition.notify_all();
+        }
+        lock.unlock();
+        condition.notify_all();
+        if (!batch.empty()) {
+            deliver(batch);
+        }
+    };
+    if (_ordered) {
+        _walk_in_order<B>(root, visit, callback);
+    } else if (std::experimental::filesystem::is_directory(root)) {
+        directories.push_back(root);
+        threads.reserve(_threads);
+        for (size_type i = 0; i < _threads; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto&& thread: threads) {
+            thread.join();
+        }
+    }
+}
+
+// Walks the directories level by level, each level being listed on several
+// threads, sorts the elements and the subdirectories of each directory by
+// path, and delivers the elements of a directory once it and the directories
+// before it on its level are listed, so that the batches and their order only
+// depend on the tree whatever the number of threads
+template <class B, class V, class G>
+void
+directory_walker::
+_walk_in_order(const path_type& root, V&& visit, G&& callback)
+const
+{
+    std::vector<path_type> level;
+    std::vector<batch_type> subdirectories;
+    std::vector<B> contents;
+    std::vector<unsigned char> listed;
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+    size_type next = 0;
+    size_type delivered = 0;
+    bool delivering = false;
+    B batch;
+    auto less = [](const auto& x, const auto& y){
+        return _path(x) < _path(y);
+    };
+    auto deliver = [&](B& elements){
+        for (auto&& element: elements) {
+            if (batch.empty()) {
+                batch.reserve(_batch);
+            }
+            batch.push_back(std::move(element));
+            if (batch.size() >= _batch) {
+                callback(std::move(batch));
+                batch = B();
+            }
+        }
+        elements = B();
+    };
+    auto worker = [&](){
+        std::unique_lock<std::mutex> lock(mutex);
+        size_type i = 0;
+        size_type first = 0;
+        while (next < level.size()) {
+            i = next++;
+            lock.unlock();
+            visit(level[i], subdirectories[i], [&](
+                typename B::value_type&& element
+            ){
+                contents[i].push_back(std::move(element));
+            });
+            std::sort(contents[i].begin(), contents[i].end(), less);
+            std::sort(subdirectories[i].begin(), subdirectories[i].end());
+            lock.lock();
+            listed[i] = true;
+            while (!delivering && delivered < level.size()
+            &&     listed[delivered]) {
+                delivering = true;
+                first = delivered;
+                while (delivered < level.size() && listed[delivered]) {
+                    ++delivered;
+                }
+                lock.unlock();
+                for (size_type k = first; k < delivered; ++k) {
+                    deliver(contents[k]);
+                }
+                lock.lock();
+                delivering = false;
+            }
+        }
+    };
+    if (std::experimental::filesystem::is_directory(root)) {
+        level.push_back(root);
+    }
+    while (!level.empty()) {
+        subdirectories.assign(level.size(), batch_type());
+        contents.assign(level.size(), B());
+        listed.assign(level.size(), false);
+        next = 0;
+        delivered = 0;
+        threads.clear();
+        for (size_type i = 0; i < std::min(_threads, level.size()); ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto&& thread: threads) {
+            thread.join();
+        }
+        level.clear();
+        for (auto&& directories: subdirectories) {
+            std::move(directories.begin(), directories.end(),
+                      std::back_inserter(level));
+        }
+    }
+    if (!batch.empty()) {
+        callback(std::move(batch));
+    }
+}
+
+// Reads a directory and passes the descriptor of the directory, the name and
+// path of each entry and whether it is a directory, symbolic links excluded
+template <class F>
+void
+directory_walker::
+_read(const path_type& directory, F&& f)
+{
+    DIR* stream = ::opendir(directory.c_str());
+    struct dirent* entry = nullptr;
+    struct stat status = {};
+    path_type current;
+    bool is_directory = false;
+    while (stream && (entry = ::readdir(stream))) {
+        if (std::strcmp(entry->d_name, ".") == 0
+        ||  std::strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        current = directory / entry->d_name;
+        is_directory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            is_directory = ::fstatat(::dirfd(stream), entry->d_name, &status,
+                                     AT_SYMLINK_NOFOLLOW) == 0
+                        && S_ISDIR(status.st_mode);
+        }
+        f(::dirfd(stream), entry->d_name, current, is_directory);
+    }
+    if (stream) {
+        ::closedir(stream);
+    }
+}
+
+// Returns a path itself, to sort paths by path
+const directory_walker::path_type&
+directory_walker::
+_path(const path_type& p)
+noexcept
+{
+    return p;
+}
+
+// Returns the path of a file, to sort files by path
+directory_walker::path_type
+directory_walker::
+_path(const file& f)
+{
+    return f.path();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _DIRECTORY_WALKER_HPP_INCLUDED
+// ========================================================================== //
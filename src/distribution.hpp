@@ -0,0 +1,352 @@
+// ============================== DISTRIBUTION ============================== //
+// Project:         epidemium_oncobase
+// Name:            distribution.hpp
+// Description:     Word counts stored compactly as a structure of arrays
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * distribution.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _DISTRIBUTION_HPP_INCLUDED
+#define _DISTRIBUTION_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+// Include others
+#include "string_view.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ****************************** DISTRIBUTION ****************************** */
+// Distribution class definition
+class distribution
+{
+    // Types
+    public:
+    using view_type = string_view;
+    using size_type = std::size_t;
+    using count_type = std::size_t;
+    using offset_type = std::uint32_t;
+    using pair_type = std::pair<std::string, count_type>;
+
+    // Constants
+    public:
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    // Lifecycle
+    public:
+    distribution();
+
+    // Access
+    public:
+    view_type word(size_type i) const;
+    count_type count(size_type i) const;
+    const std::vector<count_type>& counts() const noexcept;
+    count_type total() const;
+
+    // Capacity
+    public:
+    size_type size() const noexcept;
+    bool empty() const noexcept;
+    size_type memory() const noexcept;
+
+    // Modifiers
+    public:
+    void reserve(size_type n, size_type nchars);
+    void push_back(const view_type& word, count_type count);
+    void threshold(count_type minimum);
+    void clear() noexcept;
+
+    // Sorting
+    public:
+    void sort_by_word();
+    void sort_by_count();
+    void select_by_count(size_type k);
+
+    // Conversion
+    public:
+    std::vector<pair_type> to_pairs() const;
+
+    // Implementation details: sorting
+    private:
+    template <class F>
+    void _permute(F&& comparator, size_type k);
+
+    // Implementation details: data members
+    private:
+    std::string _characters;
+    std::vector<offset_type> _offsets;
+    std::vector<count_type> _counts;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------ DISTRIBUTION: LIFECYCLE ------------------------- //
+// Constructs an empty distribution
+distribution::
+distribution()
+: _characters()
+, _offsets()
+, _counts()
+{
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- DISTRIBUTION: ACCESS -------------------------- //
+// Returns a view over the i-th word, valid until the distribution changes
+distribution::view_type
+distribution::
+word(size_type i)
+const
+{
+    const size_type first = _offsets[i];
+    const size_type last = i + 1 < _offsets.size()
+                         ? _offsets[i + 1]
+                         : _characters.size();
+    return first < last
+         ? view_type(_characters.data() + first, last - first)
+         : view_type();
+}
+
+// Returns the count of the i-th word
+distribution::count_type
+distribution::
+count(size_type i)
+const
+{
+    return _counts[i];
+}
+
+// Returns the counts of all the words, in order
+const std::vector<distribution::count_type>&
+distribution::
+counts()
+const noexcept
+{
+    return _counts;
+}
+
+// Returns the sum of the counts
+distribution::count_type
+distribution::
+total()
+const
+{
+    return std::accumulate(_counts.begin(), _counts.end(), count_type());
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- DISTRIBUTION: CAPACITY ------------------------- //
+// Returns the number of words
+distribution::size_type
+distribution::
+size()
+const noexcept
+{
+    return _counts.size();
+}
+
+// Checks whether the distribution is empty
+bool
+distribution::
+empty()
+const noexcept
+{
+    return _counts.empty();
+}
+
+// Returns the number of bytes held by the arrays
+distribution::size_type
+distribution::
+memory()
+const noexcept
+{
+    return _characters.capacity()
+         + _offsets.capacity() * sizeof(offset_type)
+         + _counts.capacity() * sizeof(count_type);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ DISTRIBUTION: MODIFIERS ------------------------- //
+// Reserves room for a number of words totalling a number of characters
+void
+distribution::
+reserve(size_type n, size_type nchars)
+{
+    _characters.reserve(nchars);
+    _offsets.reserve(n);
+    _counts.reserve(n);
+}
+
+// Appends a word with its count
+void
+distribution::
+push_back(const view_type& word, count_type count)
+{
+    _offsets.push_back(_characters.size());
+    if (word.size()) {
+        _characters.append(word.data(), word.size());
+    }
+    _counts.push_back(count);
+}
+
+// Removes the words counted fewer times than the minimum, keeping the order
+// of the others, in a single pass, the kept characters being moved down in
+// place over ranges that may overlap
+void
+distribution::
+threshold(count_type minimum)
+{
+    size_type j = 0;
+    size_type chars = 0;
+    view_type w;
+    for (size_type i = 0; i < size(); ++i) {
+        if (_counts[i] >= minimum) {
+            w = word(i);
+            if (w.size() && w.data() != &_characters[chars]) {
+                std::memmove(&_characters[chars], w.data(), w.size());
+            }
+            _offsets[j] = chars;
+            _counts[j] = _counts[i];
+            chars += w.size();
+            ++j;
+        }
+    }
+    _characters.resize(chars);
+    _offsets.resize(j);
+    _counts.resize(j);
+}
+
+// Removes all the words, keeping the storage
+void
+distribution::
+clear()
+noexcept
+{
+    _characters.clear();
+    _offsets.clear();
+    _counts.clear();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- DISTRIBUTION: SORTING -------------------------- //
+// Sorts the words alphabetically
+void
+distribution::
+sort_by_word()
+{
+    _permute([this](size_type i, size_type j){
+        return word(i) < word(j);
+    }, size());
+}
+
+// Sorts the words by decreasing count, then alphabetically
+void
+distribution::
+sort_by_count()
+{
+    select_by_count(size());
+}
+
+// Keeps the k most frequent words sorted by decreasing count then
+// alphabetically, selecting them before sorting only them
+void
+distribution::
+select_by_count(size_type k)
+{
+    _permute([this](size_type i, size_type j){
+        bool more = _counts[i] > _counts[j];
+        return more || (_counts[i] == _counts[j] && word(i) < word(j));
+    }, k);
+}
+
+// Reorders the three arrays according to a comparison of word indices,
+// keeping only the k first words
+template <class F>
+void
+distribution::
+_permute(F&& comparator, size_type k)
+{
+    std::vector<offset_type> order(size());
+    distribution sorted;
+    std::iota(order.begin(), order.end(), offset_type());
+    if (k < order.size()) {
+        std::nth_element(order.begin(), order.begin() + k, order.end(),
+                         comparator);
+        order.resize(k);
+    }
+    std::sort(order.begin(), order.end(), comparator);
+    sorted.reserve(order.size(), _characters.size());
+    for (auto&& i: order) {
+        sorted.push_back(word(i), _counts[i]);
+    }
+    std::swap(*this, sorted);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ DISTRIBUTION: CONVERSION ------------------------ //
+// Converts the distribution to pairs of strings and counts
+std::vector<distribution::pair_type>
+distribution::
+to_pairs()
+const
+{
+    std::vector<pair_type> pairs(size());
+    view_type w;
+    for (size_type i = 0; i < size(); ++i) {
+        w = word(i);
+        pairs[i].first.assign(w.begin(), w.end());
+        pairs[i].second = _counts[i];
+    }
+    return pairs;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _DISTRIBUTION_HPP_INCLUDED
+// ========================================================================== //
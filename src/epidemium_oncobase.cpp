@@ -32,7 +32,11 @@
 
 // ============================== PREPROCESSOR ============================== //
 // Include C++
+#include <string>
 #include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <iostream>
 #include <algorithm>
@@ -40,10 +44,24 @@
 #include "file.hpp"
 #include "table.hpp"
 #include "article.hpp"
+#include "directory_walker.hpp"
+#include "manifest.hpp"
+#include "pipeline.hpp"
+#include "memory_map.hpp"
+#include "buffered_writer.hpp"
 #include "ftp_manager.hpp"
 #include "string_view.hpp"
+#include "character_class.hpp"
+#include "term_matcher.hpp"
+#include "cooccurrence_matrix.hpp"
+#include "batch_driver.hpp"
+#include "histogram.hpp"
+#include "metrics.hpp"
 // Miscellaneous
 using namespace epidemium_oncobase;
+using std::experimental::filesystem::absolute;
+using std::experimental::filesystem::current_path;
+using std::experimental::filesystem::create_directories;
 // ========================================================================== //
 
 
@@ -120,16 +138,56 @@ void sort_by_second_member(C&& container, bool reverse = false)
 
 
 
+// --------------------------- ARGUMENT PARSING ----------------------------- //
+// Parses a count given as a decimal argument, returning the fallback for an
+// empty argument, and flagging the arguments as invalid if it is not a number
+std::size_t parse_count(const std::string& text, std::size_t fallback,
+                        bool& valid)
+{
+    const bool digits = text.size() && text.size() < 19
+                     && std::all_of(text.begin(), text.end(), [](char c){
+                            return c >= '0' && c <= '9';
+                        });
+    valid = valid && (text.empty() || digits);
+    return digits ? std::stoull(text) : fallback;
+}
+// -------------------------------------------------------------------------- //
+
+
+
 /* ********************************** MAIN ********************************** */
 // Test and debug
 int main(int argc, char** argv)
 {
     // Types
-    using word_distribution = article::word_distribution;
+    using id_type = term_matcher::id_type;
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    using nanoseconds = std::chrono::nanoseconds;
+    using clock_type = std::chrono::steady_clock;
+    using count_type = cooccurrence_matrix::count_type;
+    struct job
+    {
+        std::string path;
+        memory_map contents;
+        article::term_distribution found;
+        bool about_cancer;
+    };
+    struct accumulator
+    {
+        std::vector<std::size_t> totals;
+        cooccurrence_matrix cooccurrences;
+    };
     
     // Constants
     static const std::string nullstr = std::string();
     static const std::string cancer = "cancer";
+    static const std::string usage = "usage: epidemium_oncobase pubmed "
+        "dictionary [manifest] [output] [threads] [compiled] [checkpoint] "
+        "[shard] [metrics] [period]";
+    static constexpr std::size_t minimum = 4;
+    static constexpr std::size_t period = 1000;
+    static constexpr const char* shard_magic = "ONCOSHD1";
+    static constexpr std::size_t shard_magic_size = 8;
     std::vector<std::string> cancer_words = {
         "breast", "treatment", "carcinoma", "chemotherapy", "colorectal", 
         "ovarian", "gastric", "doxorubicin", "cytoplasmic", "gemcitabine", 
@@ -138,103 +196,438 @@ int main(int argc, char** argv)
         "lung", "serum", "prostate", "melanoma", "renal"
     };
     
-    // Variables
+    // Arguments
+    bool valid = true;
     const std::string pubmed = argc > 1 ? std::string(argv[1]) : nullstr;
     const std::string dictionary = argc > 2 ? std::string(argv[2]) : nullstr;
+    const std::string manifest_path = argc > 3 ? std::string(argv[3]) : nullstr;
+    const std::string output_path = argc > 4 ? std::string(argv[4]) : nullstr;
+    const std::string threads = argc > 5 ? std::string(argv[5]) : nullstr;
+    std::vector<std::size_t> stage_threads = {1, 0, 1};
+    std::size_t stage = 0;
+    std::size_t separator = 0;
+    const std::string compiled_path = argc > 6 ? std::string(argv[6]) : nullstr;
+    const std::string checkpoint = argc > 7 ? std::string(argv[7]) : nullstr;
+    const std::size_t shard = parse_count(argc > 8 ? argv[8] : nullstr,
+                                          std::size_t(batch_driver::shard),
+                                          valid);
+    const std::string metrics_path = argc > 9 ? std::string(argv[9]) : nullstr;
+    const std::size_t interval = std::max(
+        parse_count(argc > 10 ? argv[10] : nullstr, period, valid),
+        std::size_t(1)
+    );
+    
+    // Reads the threads of the stages, either as a comma-separated list for
+    // the loading, the matching and the aggregation, or as a single number
+    // for the matching, zero meaning one per hardware thread
+    stage = threads.find(',') == std::string::npos ? 1 : 0;
+    for (std::size_t i = 0; i <= threads.size(); i = separator + 1) {
+        separator = std::min(threads.find(',', i), threads.size());
+        valid = valid && stage < stage_threads.size();
+        if (valid) {
+            stage_threads[stage] = parse_count(
+                threads.substr(i, separator - i), stage_threads[stage], valid
+            );
+        }
+        ++stage;
+    }
+    
+    // Stops on invalid arguments after printing the usage
+    if (!valid) {
+        std::cerr<<usage<<std::endl;
+        return 1;
+    }
+    
+    // Variables
+    const auto directory = current_path();
     auto filter = [](auto&& p){return p.extension() == ".txt";};
-    auto articles = file(pubmed).get_recursive_contents(filter);
-    auto medical_dictionary = file(dictionary).read_wide();
-    auto view = string_view(medical_dictionary);
-    std::vector<string_view> words = view.split("\n");
+    directory_walker walker(0, directory_walker::batch, !checkpoint.empty());
+    pipeline<job> stages;
+    batch_driver driver(checkpoint, shard);
+    metrics monitor("epidemium_oncobase_");
+    metrics::counter_type& articles = monitor.add_counter(
+        "articles_total", "Articles processed or resumed"
+    );
+    metrics::counter_type& cancer_articles = monitor.add_counter(
+        "cancer_articles_total", "Articles about cancer"
+    );
+    metrics::counter_type& bytes = monitor.add_counter(
+        "bytes_read_total", "Bytes of the articles loaded"
+    );
+    metrics::counter_type& shards = monitor.add_counter(
+        "shards_total", "Shards processed or resumed"
+    );
+    metrics::counter_type& resumed_shards = monitor.add_counter(
+        "resumed_shards_total", "Shards resumed from the checkpoint"
+    );
+    std::vector<metrics::gauge_type*> depths;
+    manifest corpus(manifest_path);
+    buffered_writer output = output_path.size()
+                           ? file(output_path).writer()
+                           : buffered_writer(STDOUT_FILENO);
+    chunk_reader medical_dictionary;
+    string_view view;
+    string_view::const_iterator newline;
+    std::string word;
+    term_matcher terms;
+    std::vector<id_type> targets;
+    id_type cancer_id = term_matcher::npos;
+    id_type id = term_matcher::npos;
     auto rem = [=](auto&& w){
         return std::any_of(std::begin(w), std::end(w), [](auto&& c){
-            return (std::isupper(c) || std::isdigit(c));
+            return character_class::is(c, character_class::upper
+                                        | character_class::digit);
         });
     };
-    auto word_it = std::remove_if(std::begin(words), std::end(words), rem);
-    std::vector<std::string> medical_words(std::begin(words), word_it);
-    std::size_t medical_size = medical_words.size();
-    word_distribution input_distribution;
-    word_distribution output_distribution;
-    article paper;
+    auto add_words = [&](const string_view& lines){
+        for (auto&& line: lines.split("\n")) {
+            word.assign(line.begin(), line.end());
+            utf8_repair(word);
+            if (!rem(word)) {
+                terms.insert(word);
+            }
+        }
+    };
+    std::vector<article> papers;
+    std::vector<accumulator> accumulators;
+    std::vector<std::size_t> totals;
+    table<count_type> cooccurrence_table;
+    std::vector<unsigned char> shard_flags;
+    std::vector<std::pair<id_type, std::uint64_t>> shard_totals;
+    cooccurrence_matrix shard_cooccurrences;
+    table<count_type> shard_table;
+    std::vector<id_type> ranking;
     std::size_t total = 0;
     std::size_t count = 0;
-    std::size_t i = 0;
-    std::map<std::string, std::size_t> map;
-    std::map<std::string, std::map<std::string, std::size_t>> word_map;
+    const std::size_t n = cancer_words.size();
+    std::vector<std::string> paths;
     
-    // Produces the medical dictionary
-    std::sort(std::begin(medical_words), std::end(medical_words));
+    // Maps the medical dictionary if it is already compiled, or produces it
+    // line by line, the last incomplete line of each chunk being carried to
+    // the next one however long it is, compiles it into an automaton and saves
+    // it if asked to
+    if (!terms.load(dictionary)) {
+        medical_dictionary = file(dictionary).chunks();
+        while (medical_dictionary.next()) {
+            view = medical_dictionary.view();
+            newline = std::find(view.rbegin(), view.rend(), '\n').base();
+            add_words(string_view(view.begin(), newline));
+            medical_dictionary.carry(view.end() - newline);
+        }
+        add_words(medical_dictionary.view());
+        terms.compile();
+    }
+    if (compiled_path.size()) {
+        terms.save(compiled_path);
+    }
     
-    // Prepares the word map
-    for (auto&& word1: cancer_words) {
-        for (auto&& word2: cancer_words) {
-            word_map[word1][word2] = 0;
+    // Finds the cancer words in the dictionary, maps their terms to their
+    // index among the cancer words, and sizes the per-term arrays
+    cancer_id = terms.find(cancer);
+    targets.assign(terms.size(), id_type(term_matcher::npos));
+    for (id_type k = 0; k < n; ++k) {
+        id = terms.find(cancer_words[k]);
+        if (id != term_matcher::npos) {
+            targets[id] = k;
         }
     }
+    totals.assign(terms.size(), 0);
+    cooccurrence_table.resize(n, n);
+    shard_cooccurrences.resize(n);
     
-    // Loops over articles
-    for (const auto& f: articles) {
-        std::cout<<count<<" "<<std::string(f.get_absolute_path())<<std::endl;
-        i = 0;
-        paper.load(std::string(f.get_absolute_path()));
-        input_distribution = paper.compute_word_distribution();
-        std::sort(std::begin(input_distribution), std::end(input_distribution));
-        for (auto&& input: input_distribution) {
-            if (input.second > 3) {
-                while (i < medical_size && medical_words[i] < input.first) {
-                    ++i;
-                }
-                if (i < medical_words.size()) {
-                    if (input.first == medical_words[i]) {
-                        output_distribution.push_back(input);
-                    }
-                } else {
-                    break;
-                }
+    // Wraps the function of a stage into one recording its latency in a new
+    // histogram
+    auto timed = [&](const std::string& name, auto f){
+        histogram& latency = monitor.add_histogram(
+            name + "_latency_nanoseconds", "Latency of the " + name + " stage"
+        );
+        return [&latency, f](std::size_t w, job& j){
+            const clock_type::time_point start = clock_type::now();
+            const bool pass = f(w, j);
+            latency.record(std::chrono::duration_cast<nanoseconds>(
+                clock_type::now() - start
+            ).count());
+            return pass;
+        };
+    };
+    
+    // Loads an article by mapping and populating its file
+    stages.add("load", timed("load", [&](std::size_t, job& j){
+        j.contents.open(j.path, true);
+        bytes += j.contents.size();
+        return true;
+    }), stage_threads[0]);
+    
+    // Counts in one pass over the text of an article the dictionary terms
+    // present in it, that is occurring at least minimum times, and lets only
+    // the articles about cancer through
+    stages.add("match", timed("match", [&](std::size_t w, job& j){
+        article& paper = papers[w];
+        j.about_cancer = false;
+        paper.adopt(j.path, std::move(j.contents));
+        paper.compute_term_distribution(j.found, terms, minimum);
+        for (auto&& t: j.found) {
+            j.about_cancer = j.about_cancer || t.first == cancer_id;
+        }
+        paper.clear();
+        return j.about_cancer;
+    }), stage_threads[1]);
+    
+    // Adds the terms of an article about cancer to the counters of a worker
+    stages.add("aggregate", timed("aggregate", [&](std::size_t w, job& j){
+        accumulator& a = accumulators[w];
+        for (auto&& t: j.found) {
+            a.totals[t.first] += t.second;
+            if (targets[t.first] != term_matcher::npos) {
+                a.cooccurrences.insert(targets[t.first]);
             }
         }
-        sort_by_second_member(output_distribution, true);
-        if (contains_first(output_distribution, cancer)) {
-            for (auto&& item: output_distribution) {
-                if (map.find(item.first) == std::end(map)) {
-                    map[item.first] = item.second;
-                } else {
-                    map[item.first] += item.second;
-                }
+        a.cooccurrences.commit();
+        return true;
+    }), stage_threads[2]);
+    papers = std::vector<article>(stages.stage(1).threads);
+    accumulators = std::vector<accumulator>(stages.stage(2).threads);
+    for (auto&& a: accumulators) {
+        a.totals.assign(terms.size(), 0);
+        a.cooccurrences.resize(n);
+    }
+    for (std::size_t k = 0; k < stages.stage_count(); ++k) {
+        depths.push_back(&monitor.add_gauge(
+            stages.stage(k).name + "_queue_depth",
+            "Articles waiting for the " + stages.stage(k).name + " stage"
+        ));
+    }
+    
+    // Samples the depths of the queues of the stages before each report
+    auto sample = [&](){
+        for (std::size_t k = 0; k < depths.size(); ++k) {
+            depths[k]->store(stages.queued(k), std::memory_order_relaxed);
+        }
+    };
+    
+    // Starts the processing of an article from its path
+    auto load = [&](job& j, const std::string& path){
+        j.path = path;
+    };
+    
+    // Records whether the processed articles are about cancer in the order
+    // of the walk
+    auto commit = [&](job& j){
+        shard_flags.push_back(j.about_cancer);
+    };
+
+    // Saves the partial results of a shard to a file: the flags of its
+    // articles, its nonzero term totals and its cooccurrence counts
+    auto save_shard = [&](const std::string& filename){
+        buffered_writer stream(filename);
+        std::uint64_t header[] = {shard_flags.size(), terms.size(), n};
+        std::uint64_t size = shard_totals.size();
+        count_type value = 0;
+        auto write = [&](const void* data, std::size_t length){
+            stream.write(static_cast<const char*>(data), length);
+        };
+        write(shard_magic, shard_magic_size);
+        write(header, sizeof(header));
+        write(shard_flags.data(), shard_flags.size());
+        write(&size, sizeof(size));
+        for (auto&& t: shard_totals) {
+            write(&t.first, sizeof(t.first));
+            write(&t.second, sizeof(t.second));
+        }
+        for (std::size_t k = 0; k < n * n; ++k) {
+            value = shard_table.at(k / n, k % n);
+            write(&value, sizeof(value));
+        }
+        return stream.commit();
+    };
+
+    // Loads the partial results of a shard of a given number of articles,
+    // and returns false if the file is missing, corrupted or made with
+    // another dictionary
+    auto load_shard = [&](const std::string& filename, std::size_t articles){
+        memory_map map(filename);
+        const char* first = map.data();
+        const char* last = first + map.size();
+        std::uint64_t header[3] = {};
+        std::uint64_t size = 0;
+        id_type t = 0;
+        std::uint64_t value = 0;
+        count_type element = 0;
+        bool good = map.size() >= shard_magic_size;
+        auto read = [&](void* data, std::size_t length){
+            good = good && length <= static_cast<std::size_t>(last - first);
+            if (good) {
+                std::memcpy(data, first, length);
+                first += length;
+            }
+            return good;
+        };
+        good = good && std::memcmp(first, shard_magic, shard_magic_size) == 0;
+        first += good ? shard_magic_size : 0;
+        read(header, sizeof(header));
+        good = good && header[0] == articles && header[1] == terms.size();
+        good = good && header[2] == n;
+        shard_flags.resize(good ? articles : 0);
+        read(shard_flags.data(), shard_flags.size());
+        read(&size, sizeof(size));
+        shard_totals.clear();
+        for (std::uint64_t i = 0; good && i < size; ++i) {
+            read(&t, sizeof(t));
+            read(&value, sizeof(value));
+            good = good && t < terms.size();
+            shard_totals.emplace_back(t, value);
+        }
+        shard_table.resize(n, n);
+        for (std::size_t k = 0; good && k < n * n; ++k) {
+            read(&element, sizeof(element));
+            shard_table.at(k / n, k % n) = element;
+        }
+        return good;
+    };
+
+    // Counts the articles of a shard and adds its partial results to the
+    // totals
+    auto apply_shard = [&](auto first, auto last){
+        const std::size_t size = last - first;
+        const std::size_t about_cancer = std::count(
+            shard_flags.begin(), shard_flags.begin() + size, 1
+        );
+        count += about_cancer;
+        total += size;
+        articles += size;
+        cancer_articles += about_cancer;
+        shards += 1;
+        for (auto&& t: shard_totals) {
+            totals[t.first] += t.second;
+        }
+        for (std::size_t k = 0; k < n * n; ++k) {
+            cooccurrence_table.at(k / n, k % n) += shard_table.at(k / n, k % n);
+        }
+    };
+
+    // Processes the articles of a shard through the stages, gathers the
+    // counters of the workers into the partial results of the shard, saves
+    // them if the shard has a file and counts the shard
+    auto process_shard = [&](std::size_t, auto first, auto last,
+                             const std::string& filename){
+        std::uint64_t sum = 0;
+        bool saved = true;
+        shard_flags.clear();
+        shard_totals.clear();
+        shard_cooccurrences.clear();
+        stages.run(first, last, load, commit);
+        for (id_type t = 0; t < totals.size(); ++t) {
+            sum = 0;
+            for (auto&& a: accumulators) {
+                sum += a.totals[t];
+                a.totals[t] = 0;
             }
-            for (auto&& word1: cancer_words) {
-                if (contains_first(output_distribution, word1)) {
-                    for (auto&& word2: cancer_words) {
-                        if (contains_first(output_distribution, word2)) {
-                            word_map[word1][word2] += 1;
-                        }
-                    }
-                }
+            if (sum) {
+                shard_totals.emplace_back(t, sum);
             }
-            ++count;
         }
-        paper.clear();
-        output_distribution.clear();
-        ++total;
+        for (auto&& a: accumulators) {
+            shard_cooccurrences.merge(a.cooccurrences);
+            a.cooccurrences.clear();
+        }
+        shard_cooccurrences.to_table(shard_table);
+        saved = filename.empty() || save_shard(filename);
+        apply_shard(first, last);
+        return saved;
+    };
+
+    // Reads back the partial results of a shard completed by a previous run
+    // and counts the shard
+    auto resume_shard = [&](std::size_t, auto first, auto last,
+                            const std::string& filename){
+        const bool good = load_shard(filename, last - first);
+        if (good) {
+            apply_shard(first, last);
+            resumed_shards += 1;
+        }
+        return good;
+    };
+
+    // Loops over articles as they are discovered, using the manifest if any,
+    // in shards resumed from the checkpoint when they have been completed by a
+    // previous run, the walk being ordered with a checkpoint so that the same
+    // tree gives the same shards, while reporting the metrics periodically to
+    // the metrics file, or to the log if there is none
+    monitor.start(metrics_path, std::chrono::milliseconds(interval), sample);
+    if (checkpoint.size()) {
+        create_directories(checkpoint);
+        driver.load();
+    }
+    if (manifest_path.size()) {
+        walker.walk_files(pubmed, filter, [&](auto&& articles){
+            paths.clear();
+            for (const auto& f: articles) {
+                paths.push_back(absolute(f.path(), directory));
+            }
+            driver.run(paths.begin(), paths.end(), process_shard, resume_shard);
+        }, corpus);
+        corpus.prune();
+        corpus.save(manifest_path);
+    } else {
+        walker.walk(pubmed, filter, [&](auto&& articles){
+            paths.clear();
+            for (const auto& f: articles) {
+                paths.push_back(absolute(f, directory));
+            }
+            driver.run(paths.begin(), paths.end(), process_shard, resume_shard);
+        });
+    }
+    driver.finish(process_shard, resume_shard);
+    monitor.stop();
+    for (std::size_t k = 0; k <= stages.stage_count(); ++k) {
+        auto stats = k < stages.stage_count() ? stages.stage(k)
+                                               : stages.source();
+        std::clog<<"stage "<<stats.name<<": "<<stats.threads<<" threads, ";
+        std::clog<<stats.items<<" articles, ";
+        std::clog<<milliseconds(stats.busy).count()<<" ms busy, ";
+        std::clog<<milliseconds(stats.starved).count()<<" ms starved, ";
+        std::clog<<milliseconds(stats.blocked).count()<<" ms blocked, ";
+        std::clog<<(stats.items ? double(stats.depths) / stats.items : 0.);
+        std::clog<<" queued"<<std::endl;
     }
-    for (auto&& item: map) {
-        output_distribution.push_back(item);
+    std::clog<<"driver: "<<driver.shard_count()<<" shards, ";
+    std::clog<<driver.resumed_count()<<" resumed"<<std::endl;
+    
+    // Names the rows and columns of the merged cooccurrences and ranks the
+    // terms by total count
+    for (std::size_t k = 0; k < n; ++k) {
+        cooccurrence_table.row(k, cancer_words[k]);
+        cooccurrence_table.column(k, cancer_words[k]);
+    }
+    for (id_type t = 0; t < totals.size(); ++t) {
+        if (totals[t]) {
+            ranking.push_back(t);
+        }
     }
-    sort_by_second_member(output_distribution);
-    std::cout<<"========================================"<<std::endl;
-    for (auto&& item: output_distribution) {
-        std::cout<<item.first<<" "<<item.second<<std::endl;
+    std::sort(ranking.begin(), ranking.end(), [&](id_type x, id_type y){
+        bool less = totals[x] < totals[y];
+        bool tie = totals[x] == totals[y];
+        return less || (tie && terms.term(x) < terms.term(y));
+    });
+    output<<"========================================"<<'\n';
+    for (auto&& t: ranking) {
+        output<<terms.term(t)<<" "<<totals[t]<<'\n';
     }
-    std::cout<<"========================================"<<std::endl;
-    std::cout<<count<<" "<<total<<std::endl;
-    std::cout<<"========================================"<<std::endl;
-    for (auto&& word1: cancer_words) {
-        for (auto&& word2: cancer_words) {
-            std::cout<<word1<<" "<<word2<<" "<<word_map[word1][word2];
-            std::cout<<std::endl;
+    output<<"========================================"<<'\n';
+    output<<count<<" "<<total<<'\n';
+    output<<"========================================"<<'\n';
+    for (std::size_t k = 0; k < n; ++k) {
+        for (std::size_t l = 0; l < n; ++l) {
+            output<<cooccurrence_table.row(k)<<" ";
+            output<<cooccurrence_table.column(l)<<" ";
+            output<<cooccurrence_table.at(k, l)<<'\n';
         }
     }
+    if (!output.commit()) {
+        std::cerr<<"epidemium_oncobase: cannot write ";
+        std::cerr<<(output_path.size() ? output_path : "the output")<<std::endl;
+        return 1;
+    }
     return 0;
 }
 /* ************************************************************************** */
@@ -32,17 +32,27 @@
 
 // ============================== PREPROCESSOR ============================== //
 // Include C++
-#include <regex>
+#include <atomic>
 #include <cctype>
+#include <cerrno>
 #include <chrono>
 #include <random>
 #include <string>
+#include <thread>
 #include <fstream>
 #include <sstream>
 #include <utility>
 #include <iostream>
 #include <experimental/filesystem>
 // Include others
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "utf8.hpp"
+#include "date_parser.hpp"
+#include "memory_map.hpp"
+#include "chunk_reader.hpp"
+#include "buffered_writer.hpp"
 // Miscellaneous
 namespace epidemium_oncobase {
 // ========================================================================== //
@@ -63,8 +73,9 @@ class file
     using time_type = std::experimental::filesystem::file_time_type;
     using string_type = std::string;
     using binary_type = std::vector<char>;
-    using facet_type = std::codecvt_utf8<wchar_t>;
     using copy_type = std::experimental::filesystem::copy_options;
+    using stat_type = struct stat;
+    using sync_type = buffered_writer::sync_type;
     
     // Constants
     public:
@@ -78,14 +89,18 @@ class file
     
     // Lifecycle
     public:
-    file(file&& other) = default;
+    file(const file& other);
+    file(file&& other) noexcept;
     explicit file(path_type p);
-    file(path_type p, size_type s, time_type t, file_type f = regular);
+    file(path_type p, const stat_type& s);
+    file(path_type p, size_type s, time_type t, file_type f = regular,
+         size_type i = 0);
     file(path_type p, size_type s, string_type t = "", file_type f = regular);
 
     // Assignment
     public:
-    file& operator=(file&& other) = default;
+    file& operator=(const file& other);
+    file& operator=(file&& other) noexcept;
     
     // Existing properties
     public:
@@ -102,16 +117,24 @@ class file
     // Internal properties
     public:
     path_type path() const;
+    bool existence() const;
     file_type type() const;
     size_type size() const;
     time_type time() const;
+    size_type inode() const;
     string_type time_string(string_type fmt = time_fmt) const;
     
     // Input and output
     public:
     string_type read() const;
     string_type read_wide() const;
+    void read_wide(string_type& data) const;
     binary_type read_binary() const;
+    memory_map map() const;
+    chunk_reader chunks(size_type nchunk = chunk_reader::chunk,
+                        size_type noverlap = chunk_reader::overlap) const;
+    buffered_writer writer(sync_type policy = sync_type::data,
+                           size_type nbuffer = buffered_writer::buffer) const;
     file create(const string_type& data = string_type(), copy_type copy = skip);
     file remove();
     
@@ -145,212 +168,144 @@ class file
     // Factories
     public:
     static file make_temporary(const string_type& extension = "");
+    static file make_at(int fd, const char* name, path_type p);
+    
+    // Implementation details: metadata
+    private:
+    enum state_type: int {ready, pending, fetching};
+    void _fetch() const;
+    void _assign(const stat_type& s) const;
     
     // Implementation details: data members
     private:
     path_type _path;
-    file_type _type;
-    size_type _size;
-    time_type _time;
+    mutable file_type _type;
+    mutable size_type _size;
+    mutable time_type _time;
+    mutable size_type _inode;
+    mutable std::atomic<int> _state;
 };
 /* ************************************************************************** */
 
 
 
 // ---------------------------- FILE: LIFECYCLE ----------------------------- //
-// Constructs a file from a path
+// Constructs a copy of a file, fetching the metadata of the original first
+// so that the copy has its own
+file::
+file(const file& other)
+: _path(other._path)
+, _type()
+, _size()
+, _time()
+, _inode()
+, _state(ready)
+{
+    other._fetch();
+    _type = other._type;
+    _size = other._size;
+    _time = other._time;
+    _inode = other._inode;
+}
+
+// Constructs a file by stealing the path and the metadata of another file,
+// which must not be accessed by other threads meanwhile
+file::
+file(file&& other) noexcept
+: _path(std::move(other._path))
+, _type(other._type)
+, _size(other._size)
+, _time(other._time)
+, _inode(other._inode)
+, _state(other._state.load(std::memory_order_acquire))
+{
+}
+
+// Constructs a file from a path, its metadata being fetched on first access
 file::
 file(path_type p) 
-: _path(p)
+: _path(std::move(p))
 , _type()
 , _size()
 , _time()
+, _inode()
+, _state(pending)
 {
-    if (std::experimental::filesystem::exists(p)) {
-        _type = std::experimental::filesystem::status(p).type();
-        if (_type != directory) {
-            _size = std::experimental::filesystem::file_size(p);
-        }
-        _time = std::experimental::filesystem::last_write_time(p);
-    }
 }
 
-// Constructs file properties from a path, a size, a timestamp and a type
+// Constructs a file from a path and the result of a stat call
 file::
-file(path_type p, size_type s, time_type t, file_type f)
-: _path(p)
+file(path_type p, const stat_type& s) 
+: _path(std::move(p))
+, _type()
+, _size()
+, _time()
+, _inode()
+, _state(ready)
+{
+    _assign(s);
+}
+
+// Constructs file properties from a path, a size, a timestamp, a type and an
+// inode number
+file::
+file(path_type p, size_type s, time_type t, file_type f, size_type i)
+: _path(std::move(p))
 , _type(f)
 , _size(s)
 , _time(t)
+, _inode(i)
+, _state(ready)
 {
 }
 
 // Constructs file properties from a path, a size, a time string and a type
 file::
 file(path_type p, size_type s, string_type t, file_type f)
-: _path(p)
+: _path(std::move(p))
 , _type(f)
 , _size(s)
 , _time(time_type::clock::now())
+, _inode()
+, _state(ready)
 {
-    auto lower = [](char c){return std::tolower(c);};
-    tm time = tm();
-    size_type npos = string_type::npos;
-    string_type::iterator begin = std::begin(t);
-    string_type::iterator end = std::end(t);
-    std::regex regex;
-    std::sregex_iterator regex_begin = std::sregex_iterator();
-    std::sregex_iterator regex_end = regex_begin;
-    std::transform(begin, end, begin, lower);
-    string_type tmp;
-    int year = -1;
-    int month = -1;
-    int day = -1;
-    int hour = -1;
-    int min = -1;
-    int sec = -1; 
-    std::chrono::system_clock::time_point point;
+    static thread_local date_parser parser;
     if (t.size()) {
-        regex = std::regex("(\\d{4}-\\d+-\\d+-\\d+-\\+-\\d+)");
-        regex_begin = std::sregex_iterator(begin, end, regex);
-        for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-            tmp = (*i).str();
-            std::sscanf(tmp.data(), "%d-%d-%d-%d-%d-%d", 
-                        &year, &month, &day, &hour, &min, &sec);
-        }
-        if (year < 0) {
-            regex = std::regex("(\\d{4}/\\d+/\\d+/\\d+/\\+/\\d+)");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d/%d/%d/%d/%d/%d", 
-                            &year, &month, &day, &hour, &min, &sec);
-            }
-        }
-        if (year < 0) {
-            regex = std::regex("(\\d{4}-\\d+-\\d+)");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) {
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d-%d-%d", &year, &month, &day);
-            }
-        }
-        if (year < 0) {
-            regex = std::regex("(\\d+-\\d+-\\d{4})");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d-%d-%d", &day, &month, &year);
-            }
-        }
-        if (year < 0) {
-            regex = std::regex("(\\d+/\\d+/\\d{4})");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d/%d/%d", &day, &month, &year);
-            }
-        }
-        if (year < 0) {
-            regex = std::regex("(\\d{4}/\\d+/\\d+)");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d/%d/%d", &year, &month, &day);
-            }
-        }
-        if (month < 0) {
-            regex = std::regex("(\\d{4})");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                year = std::stoull((*i).str());
-            } 
-            if (t.find("jan") != npos) {
-                month = 1;
-            } else if (t.find("feb") != npos || t.find("fev") != npos) {
-                month = 2;
-            } else if (t.find("mar") != npos || t.find("mar") != npos) {
-                month = 3;
-            } else if (t.find("apr") != npos || t.find("avr") != npos) {
-                month = 4;
-            } else if (t.find("may") != npos || t.find("mai") != npos) {
-                month = 5;
-            } else if (t.find("jun") != npos || t.find("juin") != npos) {
-                month = 6;
-            } else if (t.find("jul") != npos || t.find("juil") != npos) {
-                month = 7;
-            } else if (t.find("aug") != npos || t.find("ao") != npos) {
-                month = 8;
-            } else if (t.find("sep") != npos) {
-                month = 9;
-            } else if (t.find("oct") != npos) {
-                month = 10;
-            } else if (t.find("nov") != npos) {
-                month = 11;
-            } else if (t.find("dec") != npos) {
-                month = 12;
-            }
-        }
-        if (month > 0 && day < 0) {
-            regex = std::regex(std::string("\\s+((\\d{1,2}(?=st))|(\\d")
-                  + "{1,2}(?=nd))|(\\d{1,2}(?=rd))|(\\d{1,2}(?=th)))");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                day = std::stoull((*i).str());
-            }
-        }
-        if (month > 0 && day < 0) {
-            regex = std::regex("(\\s+\\d{1,2}\\s+)|(\\s+\\d{1,2},)");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                day = std::stoull((*i).str());
-            }
-        }
-        if (hour < 0) {
-            regex = std::regex("(\\d{1,2}:\\d{1,2}:\\d{1,2})");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) {
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d:%d:%d", &hour, &min, &sec);
-            }
-        }
-        if (hour < 0) {
-            regex = std::regex("(\\d{1,2}:\\d{1,2})");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) {
-                tmp = (*i).str();
-                std::sscanf(tmp.data(), "%d:%d", &hour, &min);
-            }
-        }
-        if (hour >= 0) {
-            regex = std::regex("(\\d+\\s*pm\\s*)");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                if (hour >= 1 && hour <= 11) {
-                    hour += 12;
-                }
-            } 
-            regex = std::regex("(\\d+\\s*am\\s*)");
-            regex_begin = std::sregex_iterator(begin, end, regex);
-            for (std::sregex_iterator i = regex_begin; i != regex_end; ++i) { 
-                if (hour == 12) {
-                    hour -= 12;
-                }
-            } 
-        }
-        year >= 0 ? (time.tm_year = year - 1900) : time.tm_year;
-        month >= 0 ? (time.tm_mon = month - 1) : time.tm_mon;
-        day >= 0 ? (time.tm_mday = day) : time.tm_mday;
-        hour >= 0 ? (time.tm_hour = hour) : time.tm_hour;
-        min >= 0 ? (time.tm_min = min) : time.tm_min;
-        sec >= 0 ? (time.tm_sec = sec) : time.tm_sec;
-        _time = time_type::clock::from_time_t(std::mktime(&time));
+        _time = parser(t);
     }
 }
 // -------------------------------------------------------------------------- //
 
 
 
+// ---------------------------- FILE: ASSIGNMENT ---------------------------- //
+// Assigns a copy of a file, fetching the metadata of the original first
+file&
+file::
+operator=(const file& other)
+{
+    return *this = file(other);
+}
+
+// Assigns a file by stealing the path and the metadata of another file, none
+// of them being accessed by other threads meanwhile
+file&
+file::
+operator=(file&& other) noexcept
+{
+    _path = std::move(other._path);
+    _type = other._type;
+    _size = other._size;
+    _time = other._time;
+    _inode = other._inode;
+    _state.store(other._state.load(std::memory_order_acquire),
+                 std::memory_order_release);
+    return *this;
+}
+// -------------------------------------------------------------------------- //
+
+
+
 // ------------------------ FILE: EXISTING PROPERTIES ----------------------- //
 // Gets the current path
 file::path_type 
@@ -450,12 +405,23 @@ const
     return _path;
 }
 
+// Returns the internal existence value
+bool
+file::
+existence() 
+const
+{
+    _fetch();
+    return _type != file_type::none && _type != file_type::not_found;
+}
+
 // Returns the internal file type value
 file::file_type 
 file::
 type() 
 const
 {
+    _fetch();
     return _type;
 }
 
@@ -465,6 +431,7 @@ file::
 size() 
 const
 {
+    _fetch();
     return _size;
 }
 
@@ -474,9 +441,20 @@ file::
 time() 
 const
 {
+    _fetch();
     return _time;
 }
 
+// Returns the internal inode number
+file::size_type 
+file::
+inode() 
+const
+{
+    _fetch();
+    return _inode;
+}
+
 // Returns the internal time string
 file::string_type 
 file::
@@ -484,7 +462,7 @@ time_string(string_type fmt)
 const
 {
     char buffer[buffer_size];
-    std::time_t ctime = time_type::clock::to_time_t(_time);
+    std::time_t ctime = time_type::clock::to_time_t(time());
     std::strftime(buffer, buffer_size, fmt.data(), std::localtime(&ctime));
 	return buffer;
 }
@@ -511,30 +489,44 @@ const
     return data;
 }
 
-// Reads a wide character file
+// Reads a utf-8 text file, replacing invalid sequences
 file::string_type 
 file::
 read_wide() 
 const
 {
-    static const std::locale locale(std::locale(), new facet_type);
     string_type data;
-    string_type filename = std::experimental::filesystem::absolute(_path);
-    std::wstring_convert<facet_type, wchar_t> converter;
-    std::wifstream stream(filename, std::ios::in);
-    std::wstringstream sstream;
-    std::wstring text;
-    stream.imbue(locale);
-    sstream.imbue(locale);
-    if (stream.good()) {
-        sstream << stream.rdbuf();
-        text = static_cast<const std::wstringstream&>(sstream).str();
-        data = converter.to_bytes(text);
-        stream.close();
-    }
+    read_wide(data);
     return data;
 }
 
+// Reads a utf-8 text file into an existing string, reusing its storage,
+// retrying reads interrupted by a signal, and replaces invalid sequences
+void
+file::
+read_wide(string_type& data)
+const
+{
+    int descriptor = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    size_type count = 0;
+    ssize_t n = 0;
+    data.clear();
+    if (descriptor >= 0) {
+        if (::fstat(descriptor, &status) == 0 && status.st_size > 0) {
+            data.resize(status.st_size);
+            do {
+                n = ::read(descriptor, &data[count], data.size() - count);
+                count += n > 0 ? n : 0;
+            } while ((n > 0 || (n < 0 && errno == EINTR))
+                  && count < data.size());
+            data.resize(count);
+        }
+        ::close(descriptor);
+        utf8_repair(data);
+    }
+}
+
 // Reads a binary file
 file::binary_type 
 file::
@@ -563,21 +555,52 @@ const
     return data;
 }
 
-// Creates a text file
+// Maps a file in memory, in read-only mode, without copying its contents
+memory_map
+file::
+map() 
+const
+{
+    string_type filename = std::experimental::filesystem::absolute(_path);
+    return memory_map(filename);
+}
+
+// Opens a file for reading by chunks of bounded size, whatever its size
+chunk_reader
+file::
+chunks(size_type nchunk, size_type noverlap)
+const
+{
+    string_type filename = std::experimental::filesystem::absolute(_path);
+    return chunk_reader(filename, nchunk, noverlap);
+}
+
+// Opens a buffered writer to a temporary file replacing this file on commit
+buffered_writer
+file::
+writer(sync_type policy, size_type nbuffer)
+const
+{
+    string_type filename = std::experimental::filesystem::absolute(_path);
+    return buffered_writer(filename, policy, nbuffer);
+}
+
+// Creates a text file, atomically replaced when overwriting an existing one,
+// and reports on the error stream when it could not be written, the previous
+// file being left untouched
 file 
 file::
 create(const string_type& data, copy_type copy) 
 {
     string_type filename = std::experimental::filesystem::absolute(_path);
     bool exists = std::experimental::filesystem::exists(filename);
-    std::ofstream stream;
+    buffered_writer stream;
     if (!exists || static_cast<int>(copy & copy_type::overwrite_existing)) {
-        stream.open(filename, std::ios::out);
-        if (stream.good()) {
-            if (data.size()) {
-                stream << data;
-            }
-            stream.close();
+        stream.open(filename, sync_type::none);
+        stream << data;
+        if (!stream.commit()) {
+            std::cerr<<"epidemium_oncobase: cannot write "<<filename;
+            std::cerr<<std::endl;
         }
     }
     return file(_path);
@@ -780,7 +803,6 @@ const
     std::vector<file> contents;
     std::experimental::filesystem::recursive_directory_iterator dir(_path);
     if (std::experimental::filesystem::is_directory(_path)) {
-        contents.reserve(reserve);
         for(auto& p: dir) {
             contents.emplace_back(p);
         }
@@ -798,7 +820,6 @@ const
     std::vector<file> contents;
     std::experimental::filesystem::recursive_directory_iterator dir(_path);
     if (std::experimental::filesystem::is_directory(_path)) {
-        contents.reserve(reserve);
         for(auto& p: dir) {
             if (std::forward<F>(f)(p.path())) {
                 contents.emplace_back(p);
@@ -831,6 +852,78 @@ make_temporary(const string_type& extension)
     filename = std::string(buffer) + "-" + rdstring + extension;
     return file(directory.append(filename));
 }
+
+// Makes a file from a name relative to an open directory with a single call
+file
+file::
+make_at(int fd, const char* name, path_type p)
+{
+    stat_type status = {};
+    file result(p, 0, time_type(), file_type::none);
+    if (::fstatat(fd, name, &status, 0) == 0) {
+        result._assign(status);
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------- FILE: METADATA ------------------------------ //
+// Fetches all the metadata with a single stat call, if not already done, the
+// first access from any thread claiming the fetch while the others wait for
+// it, the state living in the file so that building one allocates nothing
+void
+file::
+_fetch()
+const
+{
+    stat_type status = {};
+    int state = _state.load(std::memory_order_acquire);
+    if (state != ready) {
+        state = pending;
+        if (_state.compare_exchange_strong(state, fetching,
+                                           std::memory_order_acq_rel)) {
+            if (::stat(_path.c_str(), &status) == 0) {
+                _assign(status);
+            }
+            _state.store(ready, std::memory_order_release);
+        } else {
+            while (_state.load(std::memory_order_acquire) != ready) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+// Assigns the metadata from the result of a stat call
+void
+file::
+_assign(const stat_type& s)
+const
+{
+    auto nanoseconds = std::chrono::nanoseconds(s.st_mtim.tv_nsec);
+    _type = file_type::unknown;
+    if (S_ISREG(s.st_mode)) {
+        _type = file_type::regular;
+    } else if (S_ISDIR(s.st_mode)) {
+        _type = file_type::directory;
+    } else if (S_ISLNK(s.st_mode)) {
+        _type = file_type::symlink;
+    } else if (S_ISBLK(s.st_mode)) {
+        _type = file_type::block;
+    } else if (S_ISCHR(s.st_mode)) {
+        _type = file_type::character;
+    } else if (S_ISFIFO(s.st_mode)) {
+        _type = file_type::fifo;
+    } else if (S_ISSOCK(s.st_mode)) {
+        _type = file_type::socket;
+    }
+    _size = _type != directory ? s.st_size : 0;
+    _inode = s.st_ino;
+    _time = time_type::clock::from_time_t(s.st_mtim.tv_sec);
+    _time += std::chrono::duration_cast<time_type::duration>(nanoseconds);
+}
 // -------------------------------------------------------------------------- //
 
 
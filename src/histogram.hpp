@@ -0,0 +1,243 @@
+// =============================== HISTOGRAM ================================ //
+// Project:         epidemium_oncobase
+// Name:            histogram.hpp
+// Description:     Counts of values in buckets of bounded relative precision
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * histogram.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _HISTOGRAM_HPP_INCLUDED
+#define _HISTOGRAM_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+// Include others
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************* HISTOGRAM ******************************** */
+// Histogram class definition
+class histogram
+{
+    // Types
+    public:
+    using size_type = std::size_t;
+    using value_type = std::uint64_t;
+
+    // Constants
+    public:
+    static constexpr size_type precision = 5;
+    static constexpr size_type width = size_type(1) << precision;
+    static constexpr size_type buckets = (64 - precision + 1) * width;
+
+    // Lifecycle
+    public:
+    histogram();
+    histogram(const histogram&) = delete;
+    histogram& operator=(const histogram&) = delete;
+
+    // Access
+    public:
+    value_type count() const noexcept;
+    value_type sum() const noexcept;
+    value_type max() const noexcept;
+    double mean() const noexcept;
+    value_type quantile(double q) const noexcept;
+
+    // Recording
+    public:
+    void record(value_type value) noexcept;
+    void clear() noexcept;
+
+    // Implementation details: buckets
+    private:
+    static size_type _index(value_type value) noexcept;
+    static value_type _highest(size_type index) noexcept;
+
+    // Implementation details: data members
+    private:
+    std::vector<std::atomic<value_type>> _buckets;
+    std::atomic<value_type> _count;
+    std::atomic<value_type> _sum;
+    std::atomic<value_type> _max;
+};
+/* ************************************************************************** */
+
+
+
+// -------------------------- HISTOGRAM: LIFECYCLE -------------------------- //
+// Constructs an empty histogram
+histogram::
+histogram()
+: _buckets(buckets)
+, _count(0)
+, _sum(0)
+, _max(0)
+{
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- HISTOGRAM: ACCESS ---------------------------- //
+// Returns the number of recorded values
+histogram::value_type
+histogram::
+count()
+const noexcept
+{
+    return _count.load(std::memory_order_relaxed);
+}
+
+// Returns the sum of the recorded values
+histogram::value_type
+histogram::
+sum()
+const noexcept
+{
+    return _sum.load(std::memory_order_relaxed);
+}
+
+// Returns the largest recorded value
+histogram::value_type
+histogram::
+max()
+const noexcept
+{
+    return _max.load(std::memory_order_relaxed);
+}
+
+// Returns the mean of the recorded values, or zero if there is none
+double
+histogram::
+mean()
+const noexcept
+{
+    const value_type n = count();
+    return n ? static_cast<double>(sum()) / n : 0.;
+}
+
+// Returns the value below which the given fraction of the recorded values
+// fall, within the relative precision of the buckets, or zero if there is
+// none, the buckets being read while other threads may still record
+histogram::value_type
+histogram::
+quantile(double q)
+const noexcept
+{
+    const value_type n = count();
+    const double fraction = std::min(std::max(q, 0.), 1.);
+    const value_type rank = n ? std::min(value_type(fraction * n), n - 1) : 0;
+    value_type seen = _buckets[0].load(std::memory_order_relaxed);
+    size_type index = 0;
+    while (seen <= rank && index + 1 < buckets) {
+        seen += _buckets[++index].load(std::memory_order_relaxed);
+    }
+    return n ? std::min(_highest(index), max()) : 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- HISTOGRAM: RECORDING -------------------------- //
+// Records a value without locking, the buckets covering each power of two
+// with the same number of linear steps so that every value is kept within a
+// relative precision of one step
+void
+histogram::
+record(value_type value)
+noexcept
+{
+    value_type largest = _max.load(std::memory_order_relaxed);
+    _buckets[_index(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+    while (value > largest && !_max.compare_exchange_weak(
+        largest, value, std::memory_order_relaxed
+    )) {
+    }
+}
+
+// Forgets the recorded values, while no other thread records
+void
+histogram::
+clear()
+noexcept
+{
+    for (auto&& bucket: _buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- HISTOGRAM: BUCKETS --------------------------- //
+// Returns the bucket of a value: the values below the width have their own
+// bucket, and the others are split by their highest bit and the precision
+// bits that follow it
+histogram::size_type
+histogram::
+_index(value_type value)
+noexcept
+{
+    const size_type top = value < width ? 0 : 63 - __builtin_clzll(value);
+    return value < width
+         ? static_cast<size_type>(value)
+         : (top - precision + 1) * width
+         + static_cast<size_type>(value >> (top - precision)) - width;
+}
+
+// Returns the largest value of a bucket
+histogram::value_type
+histogram::
+_highest(size_type index)
+noexcept
+{
+    const size_type shift = index < width ? 0 : index / width - 1;
+    const value_type step = value_type(1) << shift;
+    const value_type lowest = index < width
+                            ? value_type(index)
+                            : value_type(index % width + width) << shift;
+    return lowest + (step - 1);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _HISTOGRAM_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,341 @@
+// ================================ MANIFEST ================================ //
+// Project:         epidemium_oncobase
+// Name:            manifest.hpp
+// Description:     A persistent record of the contents of a directory tree
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * manifest.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _MANIFEST_HPP_INCLUDED
+#define _MANIFEST_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <iterator>
+#include <unordered_map>
+// Include others
+#include "file.hpp"
+#include "memory_map.hpp"
+#include "buffered_writer.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************** MANIFEST ******************************** */
+// Manifest class definition
+class manifest
+{
+    // Types
+    public:
+    using path_type = file::path_type;
+    using time_type = file::time_type;
+    using size_type = std::size_t;
+    using files_type = std::vector<file>;
+    using paths_type = std::vector<path_type>;
+
+    // Constants
+    public:
+    static constexpr const char* magic = "ONCOMAN1";
+    static constexpr size_type magic_size = 8;
+
+    // Lifecycle
+    public:
+    manifest();
+    explicit manifest(const std::string& filename);
+
+    // Access
+    public:
+    size_type directory_count() const;
+    size_type file_count() const;
+    bool find(const path_type& directory, time_type time, files_type& files,
+              paths_type& subdirectories);
+    void insert(const path_type& directory, time_type time,
+                const files_type& files, const paths_type& subdirectories);
+
+    // Management
+    public:
+    void prune();
+    void clear();
+
+    // Input and output
+    public:
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+
+    // Implementation details: records
+    private:
+    struct record
+    {
+        time_type time;
+        files_type files;
+        paths_type subdirectories;
+        bool visited;
+    };
+
+    // Implementation details: data members
+    private:
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, record> _records;
+};
+/* ************************************************************************** */
+
+
+
+// -------------------------- MANIFEST: LIFECYCLE --------------------------- //
+// Constructs an empty manifest
+manifest::
+manifest()
+: _mutex()
+, _records()
+{
+}
+
+// Constructs a manifest from a file, empty if the file cannot be loaded
+manifest::
+manifest(const std::string& filename)
+: manifest()
+{
+    load(filename);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------- MANIFEST: ACCESS ---------------------------- //
+// Returns the number of recorded directories
+manifest::size_type
+manifest::
+directory_count()
+const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _records.size();
+}
+
+// Returns the number of recorded files
+manifest::size_type
+manifest::
+file_count()
+const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_type count = 0;
+    for (auto&& item: _records) {
+        count += item.second.files.size();
+    }
+    return count;
+}
+
+// Copies the recorded contents of a directory if its timestamp is unchanged
+bool
+manifest::
+find(const path_type& directory, time_type time, files_type& files,
+     paths_type& subdirectories)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _records.find(directory.native());
+    bool found = it != _records.end() && it->second.time == time;
+    if (found) {
+        files = it->second.files;
+        subdirectories = it->second.subdirectories;
+        it->second.visited = true;
+    }
+    return found;
+}
+
+// Records the contents of a directory along with its timestamp
+void
+manifest::
+insert(const path_type& directory, time_type time, const files_type& files,
+       const paths_type& subdirectories)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _records[directory.native()] = record{time, files, subdirectories, true};
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- MANIFEST: MANAGEMENT -------------------------- //
+// Removes the directories that have not been visited since the last load
+void
+manifest::
+prune()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _records.begin(); it != _records.end();) {
+        it = it->second.visited ? std::next(it) : _records.erase(it);
+    }
+}
+
+// Removes all the records
+void
+manifest::
+clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _records.clear();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ MANIFEST: INPUT AND OUTPUT ---------------------- //
+// Loads a manifest, replacing the current records, and returns false if the
+// file is missing or corrupted
+bool
+manifest::
+load(const std::string& filename)
+{
+    memory_map map(filename);
+    const char* first = map.data();
+    const char* last = first + map.size();
+    bool good = map.size() >= magic_size;
+    std::unordered_map<std::string, record> records;
+    std::string directory;
+    std::string name;
+    record current;
+    std::uint64_t count = 0;
+    std::uint32_t nfiles = 0;
+    std::uint32_t nsubdirectories = 0;
+    std::int64_t time = 0;
+    std::int8_t type = 0;
+    std::uint64_t size = 0;
+    std::uint64_t inode = 0;
+    auto read = [&](void* data, size_type n){
+        good = good && n <= static_cast<size_type>(last - first);
+        if (good) {
+            std::memcpy(data, first, n);
+            first += n;
+        }
+        return good;
+    };
+    auto read_string = [&](std::string& str){
+        std::uint32_t n = 0;
+        if (read(&n, sizeof(n))) {
+            str.resize(n);
+            read(&str[0], n);
+        }
+        return good;
+    };
+    good = good && std::memcmp(first, magic, magic_size) == 0;
+    first += good ? magic_size : 0;
+    read(&count, sizeof(count));
+    for (std::uint64_t i = 0; good && i < count; ++i) {
+        read_string(directory);
+        read(&time, sizeof(time));
+        read(&nfiles, sizeof(nfiles));
+        current = record{time_type(time_type::duration(time)), {}, {}, false};
+        current.files.reserve(good ? nfiles : 0);
+        for (std::uint32_t j = 0; good && j < nfiles; ++j) {
+            read_string(name);
+            read(&type, sizeof(type));
+            read(&size, sizeof(size));
+            read(&time, sizeof(time));
+            read(&inode, sizeof(inode));
+            current.files.emplace_back(
+                path_type(directory) / name, size,
+                time_type(time_type::duration(time)),
+                static_cast<file::file_type>(type), inode
+            );
+        }
+        read(&nsubdirectories, sizeof(nsubdirectories));
+        for (std::uint32_t j = 0; good && j < nsubdirectories; ++j) {
+            read_string(name);
+            current.subdirectories.push_back(path_type(directory) / name);
+        }
+        records[directory] = std::move(current);
+    }
+    if (good) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _records = std::move(records);
+    }
+    return good;
+}
+
+// Saves the manifest to a temporary file renamed in place once complete
+bool
+manifest::
+save(const std::string& filename)
+const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    buffered_writer stream(filename, buffered_writer::sync_type::none);
+    std::uint64_t count = _records.size();
+    std::uint32_t n = 0;
+    std::int64_t time = 0;
+    std::int8_t type = 0;
+    std::uint64_t size = 0;
+    std::uint64_t inode = 0;
+    auto write = [&](const void* data, size_type length){
+        stream.write(static_cast<const char*>(data), length);
+    };
+    auto write_string = [&](const std::string& str){
+        n = str.size();
+        write(&n, sizeof(n));
+        write(str.data(), str.size());
+    };
+    write(magic, magic_size);
+    write(&count, sizeof(count));
+    for (auto&& item: _records) {
+        write_string(item.first);
+        time = item.second.time.time_since_epoch().count();
+        write(&time, sizeof(time));
+        n = item.second.files.size();
+        write(&n, sizeof(n));
+        for (auto&& f: item.second.files) {
+            write_string(f.filename());
+            type = static_cast<std::int8_t>(f.type());
+            size = f.size();
+            time = f.time().time_since_epoch().count();
+            inode = f.inode();
+            write(&type, sizeof(type));
+            write(&size, sizeof(size));
+            write(&time, sizeof(time));
+            write(&inode, sizeof(inode));
+        }
+        n = item.second.subdirectories.size();
+        write(&n, sizeof(n));
+        for (auto&& subdirectory: item.second.subdirectories) {
+            write_string(subdirectory.filename().native());
+        }
+    }
+    return stream.commit();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _MANIFEST_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,256 @@
+// =============================== MEMORY MAP =============================== //
+// Project:         epidemium_oncobase
+// Name:            memory_map.hpp
+// Description:     A read-only memory mapping of a file
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * memory_map.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _MEMORY_MAP_HPP_INCLUDED
+#define _MEMORY_MAP_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <utility>
+#include <cstddef>
+// Include others
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "string_view.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************* MEMORY MAP ******************************* */
+// Memory map class definition
+class memory_map
+{
+    // Types
+    public:
+    using value_type = char;
+    using size_type = std::size_t;
+    using const_pointer = const value_type*;
+    using view_type = string_view;
+
+    // Lifecycle
+    public:
+    memory_map() noexcept;
+    memory_map(memory_map&& other) noexcept;
+    explicit memory_map(const std::string& filename);
+    ~memory_map();
+
+    // Assignment
+    public:
+    memory_map& operator=(memory_map&& other) noexcept;
+
+    // Access
+    public:
+    const_pointer data() const noexcept;
+    size_type size() const noexcept;
+    bool empty() const noexcept;
+    bool is_open() const noexcept;
+    view_type view() const;
+
+    // Management
+    public:
+    void open(const std::string& filename, bool populate = false);
+    void close() noexcept;
+
+    // Implementation details: data members
+    private:
+    const_pointer _data;
+    size_type _size;
+    bool _open;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------- MEMORY MAP: LIFECYCLE -------------------------- //
+// Constructs an empty mapping
+memory_map::
+memory_map()
+noexcept
+: _data(nullptr)
+, _size(0)
+, _open(false)
+{
+}
+
+// Constructs a mapping by stealing the one of another mapping
+memory_map::
+memory_map(memory_map&& other)
+noexcept
+: _data(other._data)
+, _size(other._size)
+, _open(other._open)
+{
+    other._data = nullptr;
+    other._size = 0;
+    other._open = false;
+}
+
+// Constructs a mapping of the whole contents of the given file
+memory_map::
+memory_map(const std::string& filename)
+: memory_map()
+{
+    open(filename);
+}
+
+// Unmaps the file
+memory_map::
+~memory_map()
+{
+    close();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- MEMORY MAP: ASSIGNMENT ------------------------- //
+// Releases the current mapping and steals the one of another mapping
+memory_map&
+memory_map::
+operator=(memory_map&& other)
+noexcept
+{
+    if (this != &other) {
+        close();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_open, other._open);
+    }
+    return *this;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- MEMORY MAP: ACCESS --------------------------- //
+// Returns a pointer to the first mapped character
+memory_map::const_pointer
+memory_map::
+data()
+const noexcept
+{
+    return _data;
+}
+
+// Returns the number of mapped characters
+memory_map::size_type
+memory_map::
+size()
+const noexcept
+{
+    return _size;
+}
+
+// Checks whether the mapping is empty
+bool
+memory_map::
+empty()
+const noexcept
+{
+    return _size == 0;
+}
+
+// Checks whether a file has been successfully opened, even if it is empty
+bool
+memory_map::
+is_open()
+const noexcept
+{
+    return _open;
+}
+
+// Returns a view over the mapped characters
+memory_map::view_type
+memory_map::
+view()
+const
+{
+    return _size ? view_type(_data, _size) : view_type();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- MEMORY MAP: MANAGEMENT ------------------------- //
+// Maps the given file in read-only mode, leaving the map closed on failure,
+// and reads the whole file in advance if the pages are to be populated
+void
+memory_map::
+open(const std::string& filename, bool populate)
+{
+    struct stat status = {};
+    void* address = MAP_FAILED;
+    int flags = MAP_PRIVATE | (populate ? MAP_POPULATE : 0);
+    int descriptor = ::open(filename.data(), O_RDONLY | O_CLOEXEC);
+    close();
+    if (descriptor >= 0) {
+        if (::fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+            if (status.st_size > 0) {
+                address = ::mmap(nullptr, status.st_size, PROT_READ, flags,
+                                 descriptor, 0);
+                if (address != MAP_FAILED) {
+                    ::madvise(address, status.st_size, MADV_SEQUENTIAL);
+                    _data = static_cast<const_pointer>(address);
+                    _size = status.st_size;
+                    _open = true;
+                }
+            } else {
+                _open = true;
+            }
+        }
+        ::close(descriptor);
+    }
+}
+
+// Unmaps the file if it was mapped
+void
+memory_map::
+close()
+noexcept
+{
+    if (_data) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _MEMORY_MAP_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,453 @@
+// ================================ METRICS ================================= //
+// Project:         epidemium_oncobase
+// Name:            metrics.hpp
+// Description:     Counters, gauges and histograms reported periodically
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * metrics.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _METRICS_HPP_INCLUDED
+#define _METRICS_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+// Include others
+#include "histogram.hpp"
+#include "buffered_writer.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************** METRICS ********************************* */
+// Metrics class definition
+class metrics
+{
+    // Types
+    public:
+    using size_type = std::size_t;
+    using value_type = std::uint64_t;
+    using clock_type = std::chrono::steady_clock;
+    using duration_type = clock_type::duration;
+    using counter_type = std::atomic<std::uint64_t>;
+    using gauge_type = std::atomic<std::int64_t>;
+    using sampler_type = std::function<void()>;
+
+    // Constants
+    public:
+    static constexpr const char* json = ".json";
+    static constexpr size_type json_size = 5;
+
+    // Lifecycle
+    public:
+    explicit metrics(const std::string& prefix = "");
+    metrics(const metrics&) = delete;
+    metrics& operator=(const metrics&) = delete;
+    ~metrics();
+
+    // Registration
+    public:
+    counter_type& add_counter(const std::string& name,
+                              const std::string& help);
+    gauge_type& add_gauge(const std::string& name, const std::string& help);
+    histogram& add_histogram(const std::string& name,
+                             const std::string& help);
+
+    // Access
+    public:
+    const std::string& prefix() const noexcept;
+    duration_type uptime() const;
+
+    // Export
+    public:
+    std::string to_json() const;
+    std::string to_prometheus() const;
+    std::string summary();
+    bool save(const std::string& filename) const;
+
+    // Reporting
+    public:
+    void start(const std::string& filename, duration_type period,
+               sampler_type sample = sampler_type());
+    void stop();
+
+    // Implementation details: entries
+    private:
+    struct entry
+    {
+        std::string name;
+        std::string help;
+    };
+
+    // Implementation details: reporting
+    private:
+    static const std::vector<double>& _quantiles();
+    void _report();
+    void _run();
+
+    // Implementation details: data members
+    private:
+    std::string _prefix;
+    clock_type::time_point _start;
+    std::vector<entry> _counter_entries;
+    std::deque<counter_type> _counters;
+    std::vector<entry> _gauge_entries;
+    std::deque<gauge_type> _gauges;
+    std::vector<entry> _histogram_entries;
+    std::deque<histogram> _histograms;
+    std::vector<value_type> _previous;
+    clock_type::time_point _last;
+    std::string _filename;
+    duration_type _period;
+    sampler_type _sample;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop;
+};
+/* ************************************************************************** */
+
+
+
+// --------------------------- METRICS: LIFECYCLE --------------------------- //
+// Constructs an empty set of metrics whose exported names start with the
+// given prefix
+metrics::
+metrics(const std::string& prefix)
+: _prefix(prefix)
+, _start(clock_type::now())
+, _counter_entries()
+, _counters()
+, _gauge_entries()
+, _gauges()
+, _histogram_entries()
+, _histograms()
+, _previous()
+, _last(_start)
+, _filename()
+, _period(duration_type::zero())
+, _sample()
+, _thread()
+, _mutex()
+, _wake()
+, _stop(false)
+{
+}
+
+// Stops the reporting if any
+metrics::
+~metrics()
+{
+    stop();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- METRICS: REGISTRATION -------------------------- //
+// Adds a counter with a name and a description and returns it, the counter
+// being increased by any thread without locking, and the metrics being
+// registered before they are reported
+metrics::counter_type&
+metrics::
+add_counter(const std::string& name, const std::string& help)
+{
+    _counter_entries.push_back(entry{name, help});
+    _counters.emplace_back(0);
+    _previous.push_back(0);
+    return _counters.back();
+}
+
+// Adds a gauge with a name and a description and returns it, the gauge
+// being set by any thread without locking
+metrics::gauge_type&
+metrics::
+add_gauge(const std::string& name, const std::string& help)
+{
+    _gauge_entries.push_back(entry{name, help});
+    _gauges.emplace_back(0);
+    return _gauges.back();
+}
+
+// Adds a histogram with a name and a description and returns it, values
+// being recorded by any thread without locking
+histogram&
+metrics::
+add_histogram(const std::string& name, const std::string& help)
+{
+    _histogram_entries.push_back(entry{name, help});
+    _histograms.emplace_back();
+    return _histograms.back();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------- METRICS: ACCESS ----------------------------- //
+// Returns the prefix of the exported names
+const std::string&
+metrics::
+prefix()
+const noexcept
+{
+    return _prefix;
+}
+
+// Returns the time elapsed since the construction
+metrics::duration_type
+metrics::
+uptime()
+const
+{
+    return clock_type::now() - _start;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------- METRICS: EXPORT ----------------------------- //
+// Returns a snapshot of the metrics as a json object, histograms being
+// described by their count, sum, mean, maximum and quantiles
+std::string
+metrics::
+to_json()
+const
+{
+    std::ostringstream stream;
+    const std::chrono::duration<double> seconds = uptime();
+    stream<<"{\n  \"uptime_seconds\": "<<seconds.count();
+    stream<<",\n  \"counters\": {";
+    for (size_type k = 0; k < _counters.size(); ++k) {
+        stream<<(k ? "," : "")<<"\n    \""<<_counter_entries[k].name<<"\": ";
+        stream<<_counters[k].load(std::memory_order_relaxed);
+    }
+    stream<<"\n  },\n  \"gauges\": {";
+    for (size_type k = 0; k < _gauges.size(); ++k) {
+        stream<<(k ? "," : "")<<"\n    \""<<_gauge_entries[k].name<<"\": ";
+        stream<<_gauges[k].load(std::memory_order_relaxed);
+    }
+    stream<<"\n  },\n  \"histograms\": {";
+    for (size_type k = 0; k < _histograms.size(); ++k) {
+        stream<<(k ? "," : "")<<"\n    \""<<_histogram_entries[k].name;
+        stream<<"\": {\"count\": "<<_histograms[k].count();
+        stream<<", \"sum\": "<<_histograms[k].sum();
+        stream<<", \"mean\": "<<_histograms[k].mean();
+        stream<<", \"max\": "<<_histograms[k].max();
+        for (auto&& q: _quantiles()) {
+            stream<<", \"p"<<q * 100<<"\": "<<_histograms[k].quantile(q);
+        }
+        stream<<"}";
+    }
+    stream<<"\n  }\n}\n";
+    return stream.str();
+}
+
+// Returns a snapshot of the metrics in the prometheus text format, histograms
+// being exported as summaries
+std::string
+metrics::
+to_prometheus()
+const
+{
+    std::ostringstream stream;
+    const std::chrono::duration<double> seconds = uptime();
+    std::string name;
+    stream<<"# HELP "<<_prefix<<"uptime_seconds Time since the start\n";
+    stream<<"# TYPE "<<_prefix<<"uptime_seconds gauge\n";
+    stream<<_prefix<<"uptime_seconds "<<seconds.count()<<"\n";
+    for (size_type k = 0; k < _counters.size(); ++k) {
+        name = _prefix + _counter_entries[k].name;
+        stream<<"# HELP "<<name<<" "<<_counter_entries[k].help<<"\n";
+        stream<<"# TYPE "<<name<<" counter\n";
+        stream<<name<<" "<<_counters[k].load(std::memory_order_relaxed)<<"\n";
+    }
+    for (size_type k = 0; k < _gauges.size(); ++k) {
+        name = _prefix + _gauge_entries[k].name;
+        stream<<"# HELP "<<name<<" "<<_gauge_entries[k].help<<"\n";
+        stream<<"# TYPE "<<name<<" gauge\n";
+        stream<<name<<" "<<_gauges[k].load(std::memory_order_relaxed)<<"\n";
+    }
+    for (size_type k = 0; k < _histograms.size(); ++k) {
+        name = _prefix + _histogram_entries[k].name;
+        stream<<"# HELP "<<name<<" "<<_histogram_entries[k].help<<"\n";
+        stream<<"# TYPE "<<name<<" summary\n";
+        for (auto&& q: _quantiles()) {
+            stream<<name<<"{quantile=\""<<q<<"\"} ";
+            stream<<_histograms[k].quantile(q)<<"\n";
+        }
+        stream<<name<<"_sum "<<_histograms[k].sum()<<"\n";
+        stream<<name<<"_count "<<_histograms[k].count()<<"\n";
+    }
+    return stream.str();
+}
+
+// Returns a line describing the metrics, with the rate of each counter since
+// the previous line, the median, the 99th percentile and the maximum of each
+// histogram
+std::string
+metrics::
+summary()
+{
+    std::ostringstream stream;
+    const clock_type::time_point now = clock_type::now();
+    const std::chrono::duration<double> seconds = now - _start;
+    const std::chrono::duration<double> elapsed = now - _last;
+    value_type value = 0;
+    stream<<"metrics: "<<seconds.count()<<" s";
+    for (size_type k = 0; k < _counters.size(); ++k) {
+        value = _counters[k].load(std::memory_order_relaxed);
+        stream<<", "<<_counter_entries[k].name<<" "<<value;
+        if (elapsed.count() > 0) {
+            stream<<" ("<<(value - _previous[k]) / elapsed.count()<<"/s)";
+        }
+        _previous[k] = value;
+    }
+    for (size_type k = 0; k < _gauges.size(); ++k) {
+        stream<<", "<<_gauge_entries[k].name<<" ";
+        stream<<_gauges[k].load(std::memory_order_relaxed);
+    }
+    for (size_type k = 0; k < _histograms.size(); ++k) {
+        stream<<", "<<_histogram_entries[k].name;
+        stream<<" p50 "<<_histograms[k].quantile(0.5);
+        stream<<" p99 "<<_histograms[k].quantile(0.99);
+        stream<<" max "<<_histograms[k].max();
+    }
+    _last = now;
+    return stream.str();
+}
+
+// Saves a snapshot of the metrics to a file replaced atomically, as json if
+// its name ends with the json extension, and in the prometheus text format
+// otherwise, and returns false if the file cannot be written
+bool
+metrics::
+save(const std::string& filename)
+const
+{
+    const bool as_json = filename.size() >= json_size
+                      && filename.compare(filename.size() - json_size,
+                                          json_size, json) == 0;
+    const std::string text = as_json ? to_json() : to_prometheus();
+    buffered_writer stream(filename);
+    stream.write(text.data(), text.size());
+    return stream.commit();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- METRICS: REPORTING --------------------------- //
+// Starts reporting the metrics periodically on a thread of its own, calling
+// the sample function first to update the gauges if any, and then saving
+// them to the file, or writing their summary to the log if the file name is
+// empty, the period being at least one millisecond
+void
+metrics::
+start(const std::string& filename, duration_type period, sampler_type sample)
+{
+    const duration_type shortest = std::chrono::milliseconds(1);
+    stop();
+    _filename = filename;
+    _period = std::max(period, shortest);
+    _sample = std::move(sample);
+    _stop = false;
+    _thread = std::thread(&metrics::_run, this);
+}
+
+// Stops the periodic reporting if it is running and makes a last report
+void
+metrics::
+stop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stop = true;
+    lock.unlock();
+    _wake.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+        _report();
+    }
+}
+
+// Returns the quantiles exported for the histograms
+const std::vector<double>&
+metrics::
+_quantiles()
+{
+    static const std::vector<double> result = {0.5, 0.9, 0.99, 0.999};
+    return result;
+}
+
+// Samples and reports the metrics once
+void
+metrics::
+_report()
+{
+    if (_sample) {
+        _sample();
+    }
+    if (_filename.empty()) {
+        std::clog<<summary()<<std::endl;
+    } else {
+        save(_filename);
+    }
+}
+
+// Reports the metrics at each period until the reporting is stopped
+void
+metrics::
+_run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+        _wake.wait_for(lock, _period, [this](){return _stop;});
+        if (!_stop) {
+            lock.unlock();
+            _report();
+            lock.lock();
+        }
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _METRICS_HPP_INCLUDED
+// ========================================================================== //
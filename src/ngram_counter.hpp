@@ -0,0 +1,553 @@
+// ============================= NGRAM COUNTER ============================== //
+// Project:         epidemium_oncobase
+// Name:            ngram_counter.hpp
+// Description:     A rolling-hash counter of sequences of consecutive words
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * ngram_counter.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _NGRAM_COUNTER_HPP_INCLUDED
+#define _NGRAM_COUNTER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+// Include others
+#include "arena.hpp"
+#include "tokenizer.hpp"
+#include "string_view.hpp"
+#include "distribution.hpp"
+#include "character_class.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ***************************** NGRAM COUNTER ****************************** */
+// Ngram counter class definition
+class ngram_counter
+{
+    // Types
+    public:
+    using view_type = string_view;
+    using size_type = std::size_t;
+    using count_type = std::size_t;
+    using hash_type = std::uint64_t;
+    using id_type = std::uint32_t;
+
+    // Constants
+    public:
+    static constexpr id_type npos = static_cast<id_type>(-1);
+    static constexpr size_type capacity = 1 << 12;
+    static constexpr hash_type base = 1099511628211ULL;
+
+    // Lifecycle
+    public:
+    explicit ngram_counter(size_type n = 2, size_type ncapacity = capacity);
+
+    // Access
+    public:
+    size_type order() const noexcept;
+    size_type size() const noexcept;
+    size_type word_count() const noexcept;
+    bool empty() const noexcept;
+    size_type memory() const noexcept;
+    count_type count(const view_type& ngram) const;
+
+    // Counting
+    public:
+    void add(const view_type& token);
+    void interrupt() noexcept;
+
+    // Export
+    public:
+    template <class F>
+    void for_each(F&& f) const;
+    distribution to_distribution(count_type minimum = 0) const;
+    void to_distribution(distribution& result, count_type minimum = 0) const;
+
+    // Management
+    public:
+    void prune(count_type minimum);
+    void clear() noexcept;
+
+    // Implementation details: entries
+    private:
+    struct word
+    {
+        const char* key;
+        std::uint32_t size;
+        hash_type hash;
+    };
+    struct entry
+    {
+        count_type count;
+        hash_type hash;
+    };
+
+    // Implementation details: probing
+    private:
+    static size_type _index(hash_type h, size_type mask) noexcept;
+    size_type _word_slot(const view_type& token, hash_type h) const;
+    size_type _slot(const id_type* ids, hash_type h) const;
+    id_type _intern(const view_type& token, hash_type h);
+    void _insert(hash_type h);
+    void _grow_words();
+    void _grow();
+
+    // Implementation details: data members
+    private:
+    std::vector<id_type> _word_slots;
+    std::vector<word> _words;
+    arena _keys;
+    std::vector<id_type> _slots;
+    std::vector<entry> _entries;
+    std::vector<id_type> _sequences;
+    std::vector<id_type> _window;
+    std::vector<hash_type> _hashes;
+    hash_type _power;
+    hash_type _rolling;
+    size_type _first;
+    size_type _filled;
+};
+/* ************************************************************************** */
+
+
+
+// ----------------------- NGRAM COUNTER: LIFECYCLE ------------------------- //
+// Constructs an empty counter of sequences of n words with a number of slots
+// rounded to a power of 2
+ngram_counter::
+ngram_counter(size_type n, size_type ncapacity)
+: _word_slots()
+, _words()
+, _keys()
+, _slots()
+, _entries()
+, _sequences()
+, _window(std::max(n, size_type(1)) * 2)
+, _hashes(std::max(n, size_type(1)))
+, _power(1)
+, _rolling(0)
+, _first(0)
+, _filled(0)
+{
+    size_type count = 1;
+    while (count < ncapacity) {
+        count <<= 1;
+    }
+    _word_slots.assign(count, id_type(npos));
+    _slots.assign(count, id_type(npos));
+    for (size_type i = 1; i < _hashes.size(); ++i) {
+        _power *= base;
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- NGRAM COUNTER: ACCESS -------------------------- //
+// Returns the number of words of the sequences
+ngram_counter::size_type
+ngram_counter::
+order()
+const noexcept
+{
+    return _hashes.size();
+}
+
+// Returns the number of distinct sequences
+ngram_counter::size_type
+ngram_counter::
+size()
+const noexcept
+{
+    return _entries.size();
+}
+
+// Returns the number of distinct words met since the last clear
+ngram_counter::size_type
+ngram_counter::
+word_count()
+const noexcept
+{
+    return _words.size();
+}
+
+// Checks whether no sequence has been counted
+bool
+ngram_counter::
+empty()
+const noexcept
+{
+    return _entries.empty();
+}
+
+// Returns the number of bytes held by the tables, the sequences of word
+// identifiers and the interned words
+ngram_counter::size_type
+ngram_counter::
+memory()
+const noexcept
+{
+    return (_word_slots.capacity() + _slots.capacity()) * sizeof(id_type)
+         + _words.capacity() * sizeof(word)
+         + _entries.capacity() * sizeof(entry)
+         + _sequences.capacity() * sizeof(id_type)
+         + _keys.capacity();
+}
+
+// Returns the count of a sequence of words separated by spaces, whatever the
+// case of the words
+ngram_counter::count_type
+ngram_counter::
+count(const view_type& ngram)
+const
+{
+    const size_type n = order();
+    std::vector<id_type> ids;
+    hash_type h = 0;
+    hash_type g = 0;
+    id_type id = npos;
+    bool known = true;
+    ids.reserve(n);
+    for (auto&& token: tokenizer(ngram)) {
+        g = tokenizer::hash(token);
+        ids.push_back(_word_slots[_word_slot(token, g)]);
+        known = known && ids.back() != npos;
+        h = h * base + g;
+    }
+    if (known && ids.size() == n) {
+        id = _slots[_slot(ids.data(), h)];
+    }
+    return id != npos ? _entries[id].count : 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+// ------------------------ NGRAM COUNTER: COUNTING ------------------------- //
+// Appends a token to the window of the last words, and counts the sequence
+// they form once the window is full, the hash of the sequence being updated
+// by removing the oldest word and adding the new one
+void
+ngram_counter::
+add(const view_type& token)
+{
+    const size_type n = _hashes.size();
+    const hash_type h = tokenizer::hash(token);
+    const id_type id = _intern(token, h);
+    size_type last = _first + _filled;
+    if (_filled == n) {
+        _rolling -= _hashes[_first] * _power;
+        last = _first;
+        _first = _first + 1 < n ? _first + 1 : 0;
+    } else {
+        ++_filled;
+    }
+    _window[last] = id;
+    _window[last + n] = id;
+    _hashes[last] = h;
+    _rolling = _rolling * base + h;
+    if (_filled == n) {
+        _insert(_rolling);
+    }
+}
+
+// Empties the window, so that no sequence spans the interruption
+void
+ngram_counter::
+interrupt()
+noexcept
+{
+    _rolling = 0;
+    _first = 0;
+    _filled = 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- NGRAM COUNTER: EXPORT -------------------------- //
+// Calls a function on each sequence spelled in lowercase with single spaces
+// between the words and on its count, in the order of first occurrence
+template <class F>
+void
+ngram_counter::
+for_each(F&& f)
+const
+{
+    const size_type n = order();
+    const id_type* ids = _sequences.data();
+    std::string ngram;
+    for (auto&& e: _entries) {
+        ngram.clear();
+        for (size_type k = 0; k < n; ++k) {
+            if (k > 0) {
+                ngram.push_back(' ');
+            }
+            ngram.append(_words[ids[k]].key, _words[ids[k]].size);
+        }
+        f(view_type(ngram.data(), ngram.size()), e.count);
+        ids += n;
+    }
+}
+
+// Exports the sequences counted at least the minimum number of times with
+// their counts, in the order of first occurrence
+distribution
+ngram_counter::
+to_distribution(count_type minimum)
+const
+{
+    distribution result;
+    to_distribution(result, minimum);
+    return result;
+}
+
+// Exports the sequences counted at least the minimum number of times with
+// their counts into an existing distribution, reusing its storage
+void
+ngram_counter::
+to_distribution(distribution& result, count_type minimum)
+const
+{
+    result.clear();
+    result.reserve(_entries.size(), _entries.size() * order() * 8);
+    for_each([&result, minimum](const view_type& ngram, count_type n){
+        if (n >= minimum) {
+            result.push_back(ngram, n);
+        }
+    });
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------- NGRAM COUNTER: MANAGEMENT ------------------------ //
+// Removes the sequences counted fewer times than the minimum, keeping the
+// order of the others and the words
+void
+ngram_counter::
+prune(count_type minimum)
+{
+    const size_type n = order();
+    const size_type mask = _slots.size() - 1;
+    size_type count = 0;
+    size_type i = 0;
+    for (size_type k = 0; k < _entries.size(); ++k) {
+        if (_entries[k].count >= minimum) {
+            _entries[count] = _entries[k];
+            std::copy(_sequences.begin() + k * n,
+                      _sequences.begin() + (k + 1) * n,
+                      _sequences.begin() + count * n);
+            ++count;
+        }
+    }
+    _entries.resize(count);
+    _sequences.resize(count * n);
+    std::fill(_slots.begin(), _slots.end(), id_type(npos));
+    for (id_type id = 0; id < count; ++id) {
+        i = _index(_entries[id].hash, mask);
+        while (_slots[i] != npos) {
+            i = (i + 1) & mask;
+        }
+        _slots[i] = id;
+    }
+}
+
+// Removes all the sequences and the words and empties the window, keeping the
+// storage for reuse
+void
+ngram_counter::
+clear()
+noexcept
+{
+    if (!_words.empty()) {
+        std::fill(_word_slots.begin(), _word_slots.end(), id_type(npos));
+    }
+    if (!_entries.empty()) {
+        std::fill(_slots.begin(), _slots.end(), id_type(npos));
+    }
+    _words.clear();
+    _keys.clear();
+    _entries.clear();
+    _sequences.clear();
+    interrupt();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- NGRAM COUNTER: PROBING ------------------------- //
+// Folds a hash into a slot index
+ngram_counter::size_type
+ngram_counter::
+_index(hash_type h, size_type mask)
+noexcept
+{
+    return (h ^ (h >> 32)) & mask;
+}
+
+// Returns the slot holding the identifier of the lowercase version of a
+// token, or the empty slot where it would go
+ngram_counter::size_type
+ngram_counter::
+_word_slot(const view_type& token, hash_type h)
+const
+{
+    const size_type mask = _word_slots.size() - 1;
+    size_type i = _index(h, mask);
+    auto same = [this, &token, h](id_type id){
+        const word& w = _words[id];
+        bool result = w.hash == h && w.size == token.size();
+        for (size_type k = 0; result && k < token.size(); ++k) {
+            result = w.key[k] == tokenizer::lower(token[k]);
+        }
+        return result;
+    };
+    while (_word_slots[i] != npos && !same(_word_slots[i])) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Returns the slot holding the identifier of a sequence of word identifiers,
+// or the empty slot where it would go
+ngram_counter::size_type
+ngram_counter::
+_slot(const id_type* ids, hash_type h)
+const
+{
+    const size_type n = order();
+    const size_type mask = _slots.size() - 1;
+    size_type i = _index(h, mask);
+    auto same = [this, ids, n, h](id_type id){
+        return _entries[id].hash == h
+            && std::equal(ids, ids + n, _sequences.data() + id * n);
+    };
+    while (_slots[i] != npos && !same(_slots[i])) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Returns the identifier of a token, interning it in lowercase on its first
+// occurrence
+ngram_counter::id_type
+ngram_counter::
+_intern(const view_type& token, hash_type h)
+{
+    size_type i = _word_slot(token, h);
+    id_type id = _word_slots[i];
+    char* key = nullptr;
+    if (id == npos) {
+        if ((_words.size() + 1) * 4 > _word_slots.size() * 3) {
+            _grow_words();
+            i = _word_slot(token, h);
+        }
+        key = _keys.allocate(token.size());
+        if (token.size()) {
+            character_class::lowercase(token.data(),
+                                       token.data() + token.size(), key);
+        }
+        id = static_cast<id_type>(_words.size());
+        _words.push_back(word{
+            key, static_cast<std::uint32_t>(token.size()), h
+        });
+        _word_slots[i] = id;
+    }
+    return id;
+}
+
+// Counts the sequence of the window, storing its word identifiers on its
+// first occurrence
+void
+ngram_counter::
+_insert(hash_type h)
+{
+    const id_type* ids = _window.data() + _first;
+    size_type i = _slot(ids, h);
+    id_type id = _slots[i];
+    if (id == npos) {
+        if ((_entries.size() + 1) * 4 > _slots.size() * 3) {
+            _grow();
+            i = _slot(ids, h);
+        }
+        id = static_cast<id_type>(_entries.size());
+        _entries.push_back(entry{0, h});
+        _sequences.insert(_sequences.end(), ids, ids + order());
+        _slots[i] = id;
+    }
+    ++_entries[id].count;
+}
+
+// Doubles the number of word slots and reinserts the word identifiers
+void
+ngram_counter::
+_grow_words()
+{
+    std::vector<id_type> slots(_word_slots.size() * 2, id_type(npos));
+    const size_type mask = slots.size() - 1;
+    size_type i = 0;
+    for (id_type id = 0; id < _words.size(); ++id) {
+        i = _index(_words[id].hash, mask);
+        while (slots[i] != npos) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+    _word_slots.swap(slots);
+}
+
+// Doubles the number of sequence slots and reinserts the sequence identifiers
+void
+ngram_counter::
+_grow()
+{
+    std::vector<id_type> slots(_slots.size() * 2, id_type(npos));
+    const size_type mask = slots.size() - 1;
+    size_type i = 0;
+    for (id_type id = 0; id < _entries.size(); ++id) {
+        i = _index(_entries[id].hash, mask);
+        while (slots[i] != npos) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+    _slots.swap(slots);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _NGRAM_COUNTER_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,412 @@
+// ============================= NXML EXTRACTOR ============================= //
+// Project:         epidemium_oncobase
+// Name:            nxml_extractor.hpp
+// Description:     A streaming extraction of the text of nxml sections
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * nxml_extractor.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _NXML_EXTRACTOR_HPP_INCLUDED
+#define _NXML_EXTRACTOR_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+// Include others
+#include "utf8.hpp"
+#include "string_view.hpp"
+#include "character_class.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ***************************** NXML EXTRACTOR ***************************** */
+// Nxml extractor class definition
+class nxml_extractor
+{
+    // Types
+    public:
+    using string_type = std::string;
+    using view_type = string_view;
+    using size_type = std::size_t;
+    using const_pointer = const char*;
+
+    // Lifecycle
+    public:
+    nxml_extractor();
+    nxml_extractor(std::vector<string_type> kept,
+                   std::vector<string_type> skipped);
+
+    // Access
+    public:
+    const std::vector<string_type>& kept() const noexcept;
+    const std::vector<string_type>& skipped() const noexcept;
+
+    // Extraction
+    public:
+    static bool is_markup(const view_type& contents);
+    void extract(const view_type& markup, string_type& result) const;
+
+    // Implementation details: classes
+    private:
+    using mask_type = unsigned char;
+    struct element
+    {
+        string_type name;
+        mask_type mask;
+    };
+    static constexpr mask_type _kept_class = 1;
+    static constexpr mask_type _skipped_class = 2;
+    static constexpr mask_type _inline_class = 4;
+    static const std::vector<string_type>& _inline_names();
+    void _classify(const std::vector<string_type>& names, mask_type mask);
+    mask_type _class(const view_type& name) const;
+
+    // Implementation details: scanning
+    private:
+    static const_pointer _find(const_pointer first, const_pointer last,
+                               char c);
+    static const_pointer _tag(const_pointer first, const_pointer last,
+                              view_type& name, bool& closing, bool& empty);
+    static void _decode(const_pointer first, const_pointer last,
+                        string_type& result);
+
+    // Implementation details: data members
+    private:
+    std::vector<string_type> _kept;
+    std::vector<string_type> _skipped;
+    std::vector<std::vector<element>> _classes;
+};
+/* ************************************************************************** */
+
+
+
+// ----------------------- NXML EXTRACTOR: LIFECYCLE ------------------------ //
+// Constructs an extractor keeping the title, the abstract and the body of an
+// article, without their references, tables, figures and formulas
+nxml_extractor::
+nxml_extractor()
+: _kept({"article-title", "abstract", "body"})
+, _skipped({
+    "ref-list", "table-wrap", "table", "fig", "disp-formula",
+    "inline-formula", "tex-math", "mml:math", "xref", "supplementary-material"
+})
+, _classes()
+{
+    _classify(_kept, _kept_class);
+    _classify(_skipped, _skipped_class);
+    _classify(_inline_names(), _inline_class);
+}
+
+// Constructs an extractor keeping the text of the elements of the first list
+// except what lies within the elements of the second list
+nxml_extractor::
+nxml_extractor(std::vector<string_type> kept,
+               std::vector<string_type> skipped)
+: _kept(std::move(kept))
+, _skipped(std::move(skipped))
+, _classes()
+{
+    _classify(_kept, _kept_class);
+    _classify(_skipped, _skipped_class);
+    _classify(_inline_names(), _inline_class);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- NXML EXTRACTOR: ACCESS ------------------------- //
+// Returns the names of the elements whose text is kept
+const std::vector<nxml_extractor::string_type>&
+nxml_extractor::
+kept()
+const noexcept
+{
+    return _kept;
+}
+
+// Returns the names of the elements whose text is skipped even when kept
+const std::vector<nxml_extractor::string_type>&
+nxml_extractor::
+skipped()
+const noexcept
+{
+    return _skipped;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------- NXML EXTRACTOR: EXTRACTION ----------------------- //
+// Checks whether contents start with a tag, after a byte order mark and
+// spaces, and should therefore be extracted rather than read as plain text
+bool
+nxml_extractor::
+is_markup(const view_type& contents)
+{
+    const_pointer first = contents.data();
+    const_pointer last = first + contents.size();
+    if (last - first >= 3 && std::equal(first, first + 3, "\xEF\xBB\xBF")) {
+        first += 3;
+    }
+    first = character_class::find_non_separator(first, last);
+    return first < last && *first == '<';
+}
+
+// Walks the markup once and replaces the result by the decoded text of the
+// kept elements outside of the skipped ones, separating blocks by newlines
+void
+nxml_extractor::
+extract(const view_type& markup, string_type& result)
+const
+{
+    const_pointer first = markup.data();
+    const_pointer last = first + markup.size();
+    const_pointer next = nullptr;
+    view_type name;
+    mask_type mask = 0;
+    size_type kept = 0;
+    size_type skipped = 0;
+    bool closing = false;
+    bool empty = false;
+    result.clear();
+    while (first < last) {
+        next = _find(first, last, '<');
+        if (kept && !skipped) {
+            _decode(first, next, result);
+        }
+        first = next;
+        if (last - first >= 9 && std::equal(first, first + 9, "<![CDATA[")) {
+            next = std::search(first + 9, last, "]]>", "]]>" + 3);
+            if (kept && !skipped) {
+                result.append(first + 9, next);
+            }
+            first = next + (next < last ? 3 : 0);
+        } else if (first < last) {
+            first = _tag(first, last, name, closing, empty);
+            mask = _class(name);
+            if (!name.empty() && !closing && !empty) {
+                kept += (mask & _kept_class) != 0;
+                skipped += (mask & _skipped_class) != 0;
+            } else if (!name.empty() && closing) {
+                kept -= kept && (mask & _kept_class);
+                skipped -= skipped && (mask & _skipped_class);
+            }
+            if (!name.empty() && !(mask & _inline_class) && !result.empty()
+            &&  !character_class::is(result.back(), character_class::space)) {
+                result.push_back('\n');
+            }
+        }
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ NXML EXTRACTOR: CLASSES ------------------------- //
+// Returns the names of the elements that only style text within a word or a
+// sentence, and therefore do not separate blocks of text
+const std::vector<nxml_extractor::string_type>&
+nxml_extractor::
+_inline_names()
+{
+    static const std::vector<string_type> names = {
+        "italic", "bold", "sub", "sup", "sc", "underline", "monospace",
+        "roman", "sans-serif", "overline", "named-content", "styled-content"
+    };
+    return names;
+}
+
+// Adds a class to the names of a list, the names being indexed by length so
+// that each tag is only compared with the few names of the same length
+void
+nxml_extractor::
+_classify(const std::vector<string_type>& names, mask_type mask)
+{
+    bool found = false;
+    for (auto&& name: names) {
+        if (_classes.size() <= name.size()) {
+            _classes.resize(name.size() + 1);
+        }
+        found = false;
+        for (auto&& e: _classes[name.size()]) {
+            e.mask |= e.name == name ? mask : 0;
+            found = found || e.name == name;
+        }
+        if (!found) {
+            _classes[name.size()].push_back(element{name, mask});
+        }
+    }
+}
+
+// Returns the classes of the element of the given name
+nxml_extractor::mask_type
+nxml_extractor::
+_class(const view_type& name)
+const
+{
+    mask_type result = 0;
+    if (name.size() < _classes.size()) {
+        for (auto&& e: _classes[name.size()]) {
+            if (std::equal(name.begin(), name.end(), e.name.begin())) {
+                result |= e.mask;
+            }
+        }
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ NXML EXTRACTOR: SCANNING ------------------------ //
+// Finds the first occurrence of a character, or returns last
+nxml_extractor::const_pointer
+nxml_extractor::
+_find(const_pointer first, const_pointer last, char c)
+{
+    const void* found = first < last ? std::memchr(first, c, last - first)
+                                     : nullptr;
+    return found ? static_cast<const_pointer>(found) : last;
+}
+
+// Scans the tag starting at first and returns the position past it, setting
+// its name, or an empty name for comments, declarations and instructions
+nxml_extractor::const_pointer
+nxml_extractor::
+_tag(const_pointer first, const_pointer last, view_type& name,
+     bool& closing, bool& empty)
+{
+    const_pointer next = first + 1;
+    char quote = 0;
+    name = view_type();
+    closing = next < last && *next == '/';
+    empty = false;
+    if (last - first >= 4 && std::equal(first, first + 4, "<!--")) {
+        next = std::search(first + 4, last, "-->", "-->" + 3);
+        first = next + (next < last ? 3 : 0);
+    } else if (next < last && (*next == '!' || *next == '?')) {
+        next = _find(next, last, '>');
+        first = next + (next < last);
+    } else {
+        next += closing;
+        first = next;
+        while (next < last && *next != '>' && *next != '/'
+        &&     !character_class::is(*next, character_class::separator)) {
+            ++next;
+        }
+        name = view_type(first, next - first);
+        for (first = next; first < last && (quote || *first != '>'); ++first) {
+            if (quote) {
+                quote = *first == quote ? 0 : quote;
+            } else if (*first == '"' || *first == '\'') {
+                quote = *first;
+            }
+        }
+        empty = first > next && first < last && *(first - 1) == '/';
+        first += first < last;
+    }
+    return first;
+}
+
+// Appends text, replacing the predefined and the numeric character references
+// by the characters they stand for and keeping the unknown ones as they are
+void
+nxml_extractor::
+_decode(const_pointer first, const_pointer last, string_type& result)
+{
+    static const std::pair<const char*, char> entities[] = {
+        {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''}
+    };
+    const_pointer next = nullptr;
+    const_pointer end = nullptr;
+    const_pointer limit = nullptr;
+    view_type reference;
+    std::uint32_t code = 0;
+    std::uint32_t base = 0;
+    std::uint32_t digit = 0;
+    size_type length = 0;
+    char c = 0;
+    bool hexadecimal = false;
+    bool decoded = false;
+    while (first < last) {
+        next = _find(first, last, '&');
+        result.append(first, next);
+        first = next;
+        if (first < last) {
+            limit = first + std::min(last - first, std::ptrdiff_t(12));
+            end = std::find(first + 1, limit, ';');
+            reference = view_type(first + 1, end - first - 1);
+            decoded = false;
+            if (end < limit && reference.size() > 1 && reference[0] == '#') {
+                hexadecimal = reference[1] == 'x' || reference[1] == 'X';
+                base = hexadecimal ? 16 : 10;
+                next = first + 2 + hexadecimal;
+                code = 0;
+                decoded = next < end;
+                for (; decoded && next < end; ++next) {
+                    c = character_class::to_lower(*next);
+                    digit = c >= '0' && c <= '9' ? c - '0'
+                          : c >= 'a' && c <= 'f' ? c - 'a' + 10 : base;
+                    decoded = digit < base && code <= 0x10FFFF;
+                    code = code * base + digit;
+                }
+                if (decoded) {
+                    utf8_append(code, result);
+                }
+            } else if (end < limit) {
+                for (auto&& entity: entities) {
+                    length = std::strlen(entity.first);
+                    if (!decoded && reference.size() == length
+                    &&  std::equal(reference.begin(), reference.end(),
+                                   entity.first)) {
+                        result.push_back(entity.second);
+                        decoded = true;
+                    }
+                }
+            }
+            if (decoded) {
+                first = end + 1;
+            } else {
+                result.push_back(*first++);
+            }
+        }
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _NXML_EXTRACTOR_HPP_INCLUDED
+// ========================================================================== //
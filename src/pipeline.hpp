@@ -0,0 +1,512 @@
+// ================================ PIPELINE ================================ //
+// Project:         epidemium_oncobase
+// Name:            pipeline.hpp
+// Description:     Stages of threads joined by bounded queues
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * pipeline.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _PIPELINE_HPP_INCLUDED
+#define _PIPELINE_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+// Include others
+#include "bounded_queue.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************** PIPELINE ******************************** */
+// Pipeline class definition
+template <class T>
+class pipeline
+{
+    // Types
+    public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using clock_type = std::chrono::steady_clock;
+    using duration_type = clock_type::duration;
+    using stage_type = std::function<bool(size_type, T&)>;
+    struct statistics
+    {
+        std::string name;
+        size_type threads;
+        size_type items;
+        size_type depths;
+        duration_type busy;
+        duration_type starved;
+        duration_type blocked;
+    };
+
+    // Constants
+    public:
+    static constexpr size_type depth = 16;
+    static constexpr size_type spins = 64;
+    static constexpr size_type yields = 64;
+
+    // Lifecycle
+    public:
+    pipeline();
+    pipeline(const pipeline&) = delete;
+    pipeline& operator=(const pipeline&) = delete;
+    ~pipeline();
+
+    // Access
+    public:
+    size_type stage_count() const noexcept;
+    size_type thread_count() const noexcept;
+    size_type capacity() const noexcept;
+
+    // Metrics
+    public:
+    statistics stage(size_type k) const;
+    statistics source() const;
+    size_type queued(size_type k) const;
+
+    // Construction
+    public:
+    size_type add(const std::string& name, stage_type function,
+                  size_type nthreads = 1, size_type ndepth = depth);
+
+    // Processing
+    public:
+    template <class I, class F, class G>
+    void run(I first, I last, F&& load, G&& commit);
+
+    // Implementation details: stages
+    private:
+    struct stage_data
+    {
+        stage_type function;
+        std::unique_ptr<bounded_queue<size_type>> input;
+        statistics stats;
+    };
+
+    // Implementation details: working
+    private:
+    static void _wait(size_type& failures);
+    void _start();
+    void _join();
+    void _work(size_type k, size_type worker, size_type generation);
+    void _process(size_type k, size_type worker);
+
+    // Implementation details: data members
+    private:
+    std::vector<stage_data> _stages;
+    std::unique_ptr<bounded_queue<size_type>> _output;
+    std::vector<T> _slots;
+    std::vector<std::thread> _threads;
+    mutable std::mutex _mutex;
+    std::condition_variable _request;
+    std::condition_variable _response;
+    size_type _generation;
+    size_type _active;
+    bool _stop;
+    std::atomic<bool> _done;
+    statistics _source;
+};
+/* ************************************************************************** */
+
+
+
+// -------------------------- PIPELINE: LIFECYCLE --------------------------- //
+// Constructs a pipeline without stages, passing the items straight from the
+// loading to the commit
+template <class T>
+pipeline<T>::
+pipeline()
+: _stages()
+, _output(new bounded_queue<size_type>())
+, _slots(1)
+, _threads()
+, _mutex()
+, _request()
+, _response()
+, _generation(0)
+, _active(0)
+, _stop(false)
+, _done(false)
+, _source{"source", 1, 0, 0, duration_type::zero(), duration_type::zero(),
+          duration_type::zero()}
+{
+}
+
+// Stops the threads of the stages and joins them
+template <class T>
+pipeline<T>::
+~pipeline()
+{
+    _join();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ---------------------------- PIPELINE: ACCESS ---------------------------- //
+// Returns the number of stages
+template <class T>
+typename pipeline<T>::size_type
+pipeline<T>::
+stage_count()
+const noexcept
+{
+    return _stages.size();
+}
+
+// Returns the number of threads of all the stages
+template <class T>
+typename pipeline<T>::size_type
+pipeline<T>::
+thread_count()
+const noexcept
+{
+    size_type result = 0;
+    for (auto&& s: _stages) {
+        result += s.stats.threads;
+    }
+    return result;
+}
+
+// Returns the maximal number of items in flight
+template <class T>
+typename pipeline<T>::size_type
+pipeline<T>::
+capacity()
+const noexcept
+{
+    return _slots.size();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- PIPELINE: METRICS ---------------------------- //
+// Returns the statistics of a stage accumulated over the runs: the items it
+// processed, the mean number of items left in its input queue when it takes
+// one, the time its threads spent processing, waiting for an item to process
+// and waiting for room in the next queue, the stage with the most processing
+// time per thread being the bottleneck
+template <class T>
+typename pipeline<T>::statistics
+pipeline<T>::
+stage(size_type k)
+const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stages.at(k).stats;
+}
+
+// Returns the statistics of the calling thread accumulated over the runs:
+// the items it committed, the time it spent loading and committing them and
+// the time it waited for the stages
+template <class T>
+typename pipeline<T>::statistics
+pipeline<T>::
+source()
+const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _source;
+}
+
+// Returns the number of items waiting in the input queue of a stage, which
+// is only a snapshot while the stages run
+template <class T>
+typename pipeline<T>::size_type
+pipeline<T>::
+queued(size_type k)
+const
+{
+    return _stages.at(k).input->size();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- PIPELINE: CONSTRUCTION ------------------------- //
+// Appends a stage with the given name, function, number of threads, zero
+// meaning one per hardware thread, and input queue size, and returns its
+// index, the function being called with the index of the thread within the
+// stage and an item, and returning false to make the item skip the next
+// stages, the threads being stopped until the next run
+template <class T>
+typename pipeline<T>::size_type
+pipeline<T>::
+add(const std::string& name, stage_type function,
+    size_type nthreads, size_type ndepth)
+{
+    size_type n = 0;
+    nthreads = nthreads ? nthreads : std::thread::hardware_concurrency();
+    nthreads = std::max(nthreads, size_type(1));
+    ndepth = std::max(ndepth, size_type(1));
+    _join();
+    _stages.push_back(stage_data{
+        std::move(function),
+        std::unique_ptr<bounded_queue<size_type>>(
+            new bounded_queue<size_type>(ndepth)
+        ),
+        statistics{name, nthreads, 0, 0, duration_type::zero(),
+                   duration_type::zero(), duration_type::zero()}
+    });
+    for (auto&& s: _stages) {
+        n += s.input->capacity() + s.stats.threads;
+    }
+    _slots = std::vector<T>(n);
+    _output.reset(new bounded_queue<size_type>(n));
+    return _stages.size() - 1;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- PIPELINE: PROCESSING -------------------------- //
+// Passes the elements of a range through the stages, calling the load
+// function with an item and an element on the calling thread to start each
+// item, and the commit function with each item on the calling thread once
+// it has gone through the stages, in the order of the range, the bounded
+// queues between the stages and the bounded number of items in flight
+// holding back the loading when a stage falls behind
+template <class T>
+template <class I, class F, class G>
+void
+pipeline<T>::
+run(I first, I last, F&& load, G&& commit)
+{
+    std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
+    bounded_queue<size_type>& input = _stages.empty()
+                                    ? *_output
+                                    : *_stages.front().input;
+    const size_type n = _slots.size();
+    std::vector<unsigned char> ready(n, 0);
+    statistics local = _source;
+    clock_type::time_point mark = clock_type::now();
+    clock_type::time_point now;
+    size_type submitted = 0;
+    size_type committed = 0;
+    size_type index = 0;
+    size_type failures = 0;
+    bool pending = false;
+    bool progress = false;
+    local.items = 0;
+    local.busy = local.starved = local.blocked = duration_type::zero();
+    lock.lock();
+    _start();
+    _done.store(false, std::memory_order_release);
+    _active = _threads.size();
+    ++_generation;
+    lock.unlock();
+    _request.notify_all();
+    while (pending || first != last || committed < submitted) {
+        progress = false;
+        if (!pending && first != last && submitted - committed < n) {
+            load(_slots[submitted % n], *first);
+            pending = true;
+            ++first;
+        }
+        if (pending && input.try_push(submitted)) {
+            pending = false;
+            progress = true;
+            ++submitted;
+        }
+        while (_output->try_pop(index)) {
+            ready[index % n] = 1;
+            progress = true;
+        }
+        while (ready[committed % n]) {
+            ready[committed % n] = 0;
+            commit(_slots[committed % n]);
+            ++committed;
+        }
+        now = clock_type::now();
+        if (progress) {
+            local.busy += now - mark;
+            failures = 0;
+        } else {
+            local.starved += now - mark;
+            _wait(failures);
+        }
+        mark = now;
+    }
+    local.starved += clock_type::now() - mark;
+    local.items = committed;
+    _done.store(true, std::memory_order_release);
+    lock.lock();
+    _response.wait(lock, [this](){return _active == 0;});
+    _source.items += local.items;
+    _source.busy += local.busy;
+    _source.starved += local.starved;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- PIPELINE: WORKING ---------------------------- //
+// Backs off after a number of failed attempts to pop or push, spinning at
+// first, then yielding the processor, then sleeping
+template <class T>
+void
+pipeline<T>::
+_wait(size_type& failures)
+{
+    if (failures < spins) {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else if (failures < spins + yields) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ++failures;
+}
+
+// Starts the threads of the stages if they are stopped, the lock being held
+template <class T>
+void
+pipeline<T>::
+_start()
+{
+    if (_threads.empty()) {
+        _stop = false;
+        for (size_type k = 0; k < _stages.size(); ++k) {
+            for (size_type i = 0; i < _stages[k].stats.threads; ++i) {
+                _threads.emplace_back(&pipeline::_work, this, k, i,
+                                      _generation);
+            }
+        }
+    }
+}
+
+// Stops the threads of the stages and joins them
+template <class T>
+void
+pipeline<T>::
+_join()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stop = true;
+    lock.unlock();
+    _request.notify_all();
+    for (auto&& thread: _threads) {
+        thread.join();
+    }
+    _threads.clear();
+}
+
+// Runs a thread of a stage over each run started after the given one until
+// the threads are stopped
+template <class T>
+void
+pipeline<T>::
+_work(size_type k, size_type worker, size_type generation)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _request.wait(lock, [&](){return _stop || _generation != generation;});
+        if (_generation == generation) {
+            break;
+        }
+        generation = _generation;
+        lock.unlock();
+        _process(k, worker);
+        lock.lock();
+        if (--_active == 0) {
+            _response.notify_all();
+        }
+    }
+}
+
+// Takes the items of the input queue of a stage, processes them and passes
+// them to the next queue, or to the commit if the stage makes them skip the
+// next stages, until the end of the run, and adds its statistics to the ones
+// of the stage
+template <class T>
+void
+pipeline<T>::
+_process(size_type k, size_type worker)
+{
+    stage_data& current = _stages[k];
+    bounded_queue<size_type>& input = *current.input;
+    bounded_queue<size_type>& next = k + 1 < _stages.size()
+                                   ? *_stages[k + 1].input
+                                   : *_output;
+    const size_type n = _slots.size();
+    statistics local = statistics();
+    clock_type::time_point mark = clock_type::now();
+    clock_type::time_point now;
+    size_type index = 0;
+    size_type failures = 0;
+    bool pass = false;
+    while (!_done.load(std::memory_order_acquire)) {
+        if (input.try_pop(index)) {
+            now = clock_type::now();
+            local.starved += now - mark;
+            local.depths += input.size();
+            mark = now;
+            pass = current.function(worker, _slots[index % n]);
+            now = clock_type::now();
+            local.busy += now - mark;
+            mark = now;
+            failures = 0;
+            while (!(pass ? next : *_output).try_push(index)) {
+                _wait(failures);
+            }
+            now = clock_type::now();
+            local.blocked += now - mark;
+            mark = now;
+            failures = 0;
+            ++local.items;
+        } else {
+            _wait(failures);
+        }
+    }
+    local.starved += clock_type::now() - mark;
+    std::lock_guard<std::mutex> lock(_mutex);
+    current.stats.items += local.items;
+    current.stats.depths += local.depths;
+    current.stats.busy += local.busy;
+    current.stats.starved += local.starved;
+    current.stats.blocked += local.blocked;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _PIPELINE_HPP_INCLUDED
+// ========================================================================== //
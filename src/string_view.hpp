@@ -43,6 +43,7 @@
 #include <algorithm>
 #include <stdexcept>
 // Include others
+#include "character_class.hpp"
 // Miscellaneous
 namespace epidemium_oncobase {
 // ========================================================================== //
@@ -73,6 +74,7 @@ class string_view
     string_view() noexcept;
     template <class I> string_view(I first, I last);
     template <class C> string_view(C&& container);
+    string_view(const_pointer str, size_type count);
     
     // Conversion
     public:
@@ -137,6 +139,10 @@ class string_view
     string_type to_string() const;
     bool operator==(string_view other) const;
     bool operator!=(string_view other) const;
+    bool operator<(string_view other) const;
+    bool operator<=(string_view other) const;
+    bool operator>(string_view other) const;
+    bool operator>=(string_view other) const;
 
     // Streaming
     public:
@@ -192,6 +198,14 @@ string_view(C&& container)
 , _last(std::cend(std::forward<C>(container)))
 {
 }
+
+// Constructs a view from a pointer to raw characters and a size
+string_view::
+string_view(const_pointer str, size_type count)
+: _first(const_iterator(str))
+, _last(const_iterator(str + count))
+{
+}
 // -------------------------------------------------------------------------- //
 
 
@@ -373,27 +387,32 @@ string_view::
 split(const string_type& str) 
 const
 {
-    using type = const_reference;
-    auto is_graph = [](type e){return std::isgraph(e);};
-    auto is_not_excluded = [&str](type e){return str.find(e) == str.npos;};
-    auto first = begin();
-    auto last = first;
+    std::array<bool, 256> excluded = {};
+    auto is_not_excluded = [&excluded](value_type c){
+        return !excluded[static_cast<unsigned char>(c)];
+    };
+    const_pointer first = empty() ? nullptr : data();
+    const_pointer last = first;
+    const_pointer stop = first + size();
     std::vector<string_view> vector;
     if (str.empty()) {
-        while (last < end()) {
-            first = std::find_if(first, end(), is_graph);
-            last = std::find_if_not(first, end(), is_graph);
+        while (last < stop) {
+            first = character_class::find_graph(first, stop);
+            last = character_class::find_non_graph(first, stop);
             if (first < last) {
-                vector.emplace_back(first, last);
+                vector.emplace_back(first, last - first);
             }
             first = last;
         }
     } else {
-        while (last < end()) {
-            first = std::find_if(first, end(), is_not_excluded);
-            last = std::find_if_not(first, end(), is_not_excluded);
+        for (auto&& c: str) {
+            excluded[static_cast<unsigned char>(c)] = true;
+        }
+        while (last < stop) {
+            first = std::find_if(first, stop, is_not_excluded);
+            last = std::find_if_not(first, stop, is_not_excluded);
             if (first < last) {
-                vector.emplace_back(first, last);
+                vector.emplace_back(first, last - first);
             }
             first = last;
         }
@@ -439,9 +458,9 @@ string_view::
 lstrip() 
 const
 {
-    auto is_graph = [](value_type c){return std::isgraph(c);};
-    auto left = std::find_if(begin(), end(), is_graph);
-    return string_view(left, end());
+    const_pointer first = empty() ? nullptr : data();
+    const_pointer left = character_class::find_graph(first, first + size());
+    return string_view(begin() + (left - first), end());
 }
 
 // Left strips the view from the specified character
@@ -485,7 +504,9 @@ string_view::
 rstrip() 
 const
 {
-    auto is_graph = [](value_type c){return std::isgraph(c);};
+    auto is_graph = [](value_type c){
+        return character_class::is(c, character_class::graph);
+    };
     auto right = std::find_if(rbegin(), rend(), is_graph).base();
     return string_view(begin(), right);
 }
@@ -531,8 +552,12 @@ string_view::
 strip() 
 const
 {
-    auto is_graph = [](value_type c){return std::isgraph(c);};
-    auto left = std::find_if(begin(), end(), is_graph);
+    auto is_graph = [](value_type c){
+        return character_class::is(c, character_class::graph);
+    };
+    const_pointer first = empty() ? nullptr : data();
+    const_pointer middle = character_class::find_graph(first, first + size());
+    auto left = begin() + (middle - first);
     auto right = std::find_if(rbegin(), rend(), is_graph).base();
     return string_view(std::min(left, right), right);
 }
@@ -616,6 +641,45 @@ const
 {
     return size() != other.size() || !std::equal(begin(), end(), other.begin());
 }
+
+// Compares the two views lexicographically, as strings would be
+bool 
+string_view::
+operator<(string_view other) 
+const
+{
+    using traits = std::char_traits<value_type>;
+    const size_type n = std::min(size(), other.size());
+    const int result = n ? traits::compare(data(), other.data(), n) : 0;
+    return result < 0 || (result == 0 && size() < other.size());
+}
+
+// Compares the two views lexicographically and checks for less or equal
+bool 
+string_view::
+operator<=(string_view other) 
+const
+{
+    return !(other < *this);
+}
+
+// Compares the two views lexicographically and checks for greater
+bool 
+string_view::
+operator>(string_view other) 
+const
+{
+    return other < *this;
+}
+
+// Compares the two views lexicographically and checks for greater or equal
+bool 
+string_view::
+operator>=(string_view other) 
+const
+{
+    return !(*this < other);
+}
 // -------------------------------------------------------------------------- //
 
 
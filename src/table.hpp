@@ -188,7 +188,7 @@ void
 table<T>::
 row(size_type irow, const std::string& name)
 {
-    _columns.at(irow) = name;
+    _rows.at(irow) = name;
 }
 
 // Returns the name of the given row
@@ -327,10 +327,12 @@ table<T>::
 resize(size_type nrows, size_type mcolumns)
 {
     std::vector<T> new_contents;
+    const size_type rows = std::min(nrows, _rows.size());
+    const size_type columns = std::min(mcolumns, _columns.size());
     if (mcolumns != _columns.size()) {
         new_contents.resize(nrows * mcolumns);
-        for (size_type irow = 0; irow < _rows.size(); ++irow) {
-            for (size_type jcolumn = 0; jcolumn < _columns.size(); ++jcolumn) {
+        for (size_type irow = 0; irow < rows; ++irow) {
+            for (size_type jcolumn = 0; jcolumn < columns; ++jcolumn) {
                 new_contents[irow * mcolumns + jcolumn] = 
                     _contents[irow * _columns.size() + jcolumn];
             }
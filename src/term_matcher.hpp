@@ -0,0 +1,916 @@
+// ============================== TERM MATCHER ============================== //
+// Project:         epidemium_oncobase
+// Name:            term_matcher.hpp
+// Description:     An Aho-Corasick automaton matching terms of several words
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * term_matcher.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _TERM_MATCHER_HPP_INCLUDED
+#define _TERM_MATCHER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+// Include others
+#include "tokenizer.hpp"
+#include "memory_map.hpp"
+#include "string_view.hpp"
+#include "buffered_writer.hpp"
+#include "character_class.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ****************************** TERM MATCHER ****************************** */
+// Term matcher class definition
+class term_matcher
+{
+    // Types
+    public:
+    using view_type = string_view;
+    using size_type = std::size_t;
+    using id_type = std::uint32_t;
+    using hash_type = std::uint64_t;
+
+    // Constants
+    public:
+    static constexpr id_type npos = static_cast<id_type>(-1);
+    static constexpr size_type capacity = 1 << 10;
+    static constexpr const char* magic = "ONCODIC1";
+    static constexpr size_type magic_size = 8;
+
+    // Lifecycle
+    public:
+    explicit term_matcher(size_type ncapacity = capacity);
+    term_matcher(const term_matcher& other) = delete;
+
+    // Assignment
+    public:
+    term_matcher& operator=(const term_matcher& other) = delete;
+
+    // Access
+    public:
+    size_type size() const noexcept;
+    size_type state_count() const noexcept;
+    bool empty() const noexcept;
+    bool compiled() const noexcept;
+    bool mapped() const noexcept;
+    size_type memory() const noexcept;
+    view_type term(id_type id) const;
+    size_type dictionary(id_type id) const;
+    id_type find(const view_type& term, size_type dictionary = 0) const;
+
+    // Building
+    public:
+    id_type insert(const view_type& term, size_type dictionary = 0);
+    void compile();
+
+    // Matching
+    public:
+    template <class F>
+    void match(const view_type& text, F&& f) const;
+
+    // Management
+    public:
+    void clear();
+
+    // Input and output
+    public:
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+
+    // Implementation details: entries
+    private:
+    struct word
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+        hash_type hash;
+        id_type root;
+        std::uint32_t padding;
+    };
+    struct transition
+    {
+        std::uint64_t key;
+        id_type next;
+        std::uint32_t padding;
+    };
+    struct state
+    {
+        id_type parent;
+        id_type word;
+        id_type fail;
+        id_type depth;
+        id_type terms;
+        id_type first;
+        id_type last;
+        bool leaf;
+        char padding[3];
+    };
+    struct recent
+    {
+        const char* data;
+        std::uint32_t size;
+        id_type word;
+        id_type state;
+        id_type first;
+        id_type last;
+        bool leaf;
+    };
+    struct entry
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+        id_type dictionary;
+        id_type state;
+        id_type next;
+    };
+
+    // Implementation details: tables
+    private:
+    struct header
+    {
+        char magic[magic_size];
+        std::uint64_t word_slots;
+        std::uint64_t words;
+        std::uint64_t transitions;
+        std::uint64_t transition_count;
+        std::uint64_t states;
+        std::uint64_t terms;
+        std::uint64_t outputs;
+        std::uint64_t characters;
+    };
+    struct image
+    {
+        const id_type* word_slots;
+        const word* words;
+        const transition* transitions;
+        const state* states;
+        const entry* terms;
+        const id_type* outputs;
+        const char* characters;
+        size_type word_slot_count;
+        size_type word_count;
+        size_type transition_slot_count;
+        size_type state_count;
+        size_type term_count;
+        size_type output_count;
+        size_type character_count;
+    };
+    static bool _valid(const image& tables) noexcept;
+    void _bind() noexcept;
+    void _thaw();
+
+    // Implementation details: building
+    private:
+    void _compile();
+
+    // Implementation details: probing
+    private:
+    static constexpr std::uint64_t _empty = static_cast<std::uint64_t>(-1);
+    static size_type _index(hash_type h, size_type mask) noexcept;
+    size_type _word_slot(const view_type& token, hash_type h) const;
+    size_type _transition_slot(std::uint64_t key) const;
+    id_type _word(const view_type& token) const;
+    id_type _next(id_type s, id_type w) const;
+    id_type _walk(const view_type& term) const;
+    void _grow_words();
+    void _grow_transitions();
+
+    // Implementation details: data members
+    private:
+    std::vector<id_type> _word_slots;
+    std::vector<word> _words;
+    std::vector<transition> _transitions;
+    std::vector<state> _states;
+    std::vector<entry> _terms;
+    std::vector<id_type> _outputs;
+    std::string _characters;
+    size_type _transition_count;
+    bool _compiled;
+    memory_map _map;
+    image _image;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------ TERM MATCHER: LIFECYCLE ------------------------- //
+// Constructs an empty matcher with a number of slots rounded to a power of 2
+term_matcher::
+term_matcher(size_type ncapacity)
+: _word_slots()
+, _words()
+, _transitions()
+, _states()
+, _terms()
+, _outputs()
+, _characters()
+, _transition_count(0)
+, _compiled(true)
+, _map()
+, _image()
+{
+    size_type n = 1;
+    while (n < ncapacity) {
+        n <<= 1;
+    }
+    _word_slots.assign(n, id_type(npos));
+    _transitions.assign(n, transition{_empty, npos, 0});
+    _states.push_back(state{npos, npos, 0, 0, npos, 0, 0, true, {}});
+    _bind();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- TERM MATCHER: ACCESS -------------------------- //
+// Returns the number of terms
+term_matcher::size_type
+term_matcher::
+size()
+const noexcept
+{
+    return _image.term_count;
+}
+
+// Returns the number of states of the automaton, including the initial one
+term_matcher::size_type
+term_matcher::
+state_count()
+const noexcept
+{
+    return _image.state_count;
+}
+
+// Checks whether the matcher holds no term
+bool
+term_matcher::
+empty()
+const noexcept
+{
+    return _image.term_count == 0;
+}
+
+// Checks whether the automaton is up to date with the inserted terms
+bool
+term_matcher::
+compiled()
+const noexcept
+{
+    return _compiled;
+}
+
+// Checks whether the tables are read from a compiled dictionary file
+bool
+term_matcher::
+mapped()
+const noexcept
+{
+    return _map.is_open();
+}
+
+// Returns the number of bytes held or mapped by the tables, the automaton and
+// the words
+term_matcher::size_type
+term_matcher::
+memory()
+const noexcept
+{
+    return _map.size()
+         + _word_slots.capacity() * sizeof(id_type)
+         + _words.capacity() * sizeof(word)
+         + _transitions.capacity() * sizeof(transition)
+         + _states.capacity() * sizeof(state)
+         + _terms.capacity() * sizeof(entry)
+         + _outputs.capacity() * sizeof(id_type)
+         + _characters.capacity();
+}
+
+// Returns a term in lowercase with single spaces between its words
+term_matcher::view_type
+term_matcher::
+term(id_type id)
+const
+{
+    const entry& e = id < _image.term_count ? _image.terms[id] : _terms.at(id);
+    return e.size ? view_type(_image.characters + e.offset, e.size)
+                  : view_type();
+}
+
+// Returns the index of the dictionary a term comes from
+term_matcher::size_type
+term_matcher::
+dictionary(id_type id)
+const
+{
+    return id < _image.term_count ? _image.terms[id].dictionary
+                                  : _terms.at(id).dictionary;
+}
+
+// Returns the identifier of a term of a dictionary, whatever its case and
+// its spacing, or npos if the term is unknown
+term_matcher::id_type
+term_matcher::
+find(const view_type& term, size_type dictionary)
+const
+{
+    const id_type s = _walk(term);
+    id_type result = s != npos ? _image.states[s].terms : npos;
+    while (result != npos && _image.terms[result].dictionary != dictionary) {
+        result = _image.terms[result].next;
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- TERM MATCHER: BUILDING ------------------------- //
+// Adds a term of a dictionary, as the sequence of its lowercase tokens, and
+// returns its identifier, or npos if it has no token
+term_matcher::id_type
+term_matcher::
+insert(const view_type& term, size_type dictionary)
+{
+    id_type s = 0;
+    id_type next = npos;
+    id_type w = npos;
+    id_type id = npos;
+    size_type i = 0;
+    hash_type h = 0;
+    std::uint32_t offset = 0;
+    _thaw();
+    for (auto&& token: tokenizer(term)) {
+        h = tokenizer::hash(token);
+        i = _word_slot(token, h);
+        w = _word_slots[i];
+        if (w == npos) {
+            if ((_words.size() + 1) * 4 > _word_slots.size() * 3) {
+                _grow_words();
+                i = _word_slot(token, h);
+            }
+            w = static_cast<id_type>(_words.size());
+            offset = static_cast<std::uint32_t>(_characters.size());
+            _characters.append(token.data(), token.size());
+            character_class::lowercase(token.data(),
+                                       token.data() + token.size(),
+                                       &_characters[offset]);
+            _words.push_back(word{
+                offset, static_cast<std::uint32_t>(token.size()), h, npos, 0
+            });
+            _word_slots[i] = w;
+            _bind();
+        }
+        next = _next(s, w);
+        if (next == npos) {
+            next = static_cast<id_type>(_states.size());
+            _states.push_back(state{
+                s, w, 0, _states[s].depth + 1, npos, 0, 0, true, {}
+            });
+            _compiled = false;
+            if (s == 0) {
+                _words[w].root = next;
+            } else {
+                if ((_transition_count + 1) * 4 > _transitions.size() * 3) {
+                    _grow_transitions();
+                }
+                i = _transition_slot((std::uint64_t(s) << 32) | w);
+                _transitions[i] = transition{
+                    (std::uint64_t(s) << 32) | w, next, 0
+                };
+                ++_transition_count;
+            }
+        }
+        s = next;
+    }
+    id = s != 0 ? _states[s].terms : npos;
+    while (id != npos && _terms[id].dictionary != dictionary) {
+        id = _terms[id].next;
+    }
+    if (s != 0 && id == npos) {
+        id = static_cast<id_type>(_terms.size());
+        offset = static_cast<std::uint32_t>(_characters.size());
+        for (auto&& token: tokenizer(term)) {
+            if (_characters.size() > offset) {
+                _characters.push_back(' ');
+            }
+            _characters.append(token.data(), token.size());
+        }
+        character_class::lowercase(_characters.data() + offset,
+                                   _characters.data() + _characters.size(),
+                                   &_characters[offset]);
+        _terms.push_back(entry{
+            offset, static_cast<std::uint32_t>(_characters.size() - offset),
+            static_cast<id_type>(dictionary), s, _states[s].terms
+        });
+        _states[s].terms = id;
+        _compiled = false;
+    }
+    _bind();
+    return id;
+}
+
+// Computes the automaton if terms have been inserted since it was computed
+void
+term_matcher::
+compile()
+{
+    if (!_compiled) {
+        _compile();
+    }
+}
+
+// Computes the failure transitions breadth first, each state falling back to
+// the longest suffix of its words that is also a state, gathers for each state
+// the terms ending there or at the states it falls back to, and marks as
+// leaves the states from which every word leads where it leads from the root:
+// the root itself, and the states without children falling back to the root
+// or to a leaf
+void
+term_matcher::
+_compile()
+{
+    std::vector<id_type> order(_states.size());
+    id_type f = 0;
+    id_type next = npos;
+    id_type output = 0;
+    for (id_type k = 0; k < order.size(); ++k) {
+        order[k] = k;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](id_type x, id_type y){
+        return _states[x].depth < _states[y].depth;
+    });
+    _outputs.clear();
+    for (auto&& current: _states) {
+        current.leaf = true;
+    }
+    for (id_type k = 1; k < _states.size(); ++k) {
+        _states[_states[k].parent].leaf = false;
+    }
+    for (auto&& k: order) {
+        state& current = _states[k];
+        f = current.depth > 1 ? _states[current.parent].fail : 0;
+        next = current.depth > 1 ? _next(f, current.word) : 0;
+        while (next == npos && f != 0) {
+            f = _states[f].fail;
+            next = _next(f, current.word);
+        }
+        current.fail = next != npos ? next : 0;
+        current.first = static_cast<id_type>(_outputs.size());
+        for (id_type id = current.terms; id != npos; id = _terms[id].next) {
+            _outputs.push_back(id);
+        }
+        std::reverse(_outputs.begin() + current.first, _outputs.end());
+        for (id_type j = _states[current.fail].first;
+             k != 0 && j < _states[current.fail].last; ++j) {
+            output = _outputs[j];
+            _outputs.push_back(output);
+        }
+        current.last = static_cast<id_type>(_outputs.size());
+        current.leaf = current.leaf
+                    && (current.fail == 0 || _states[current.fail].leaf);
+    }
+    _states[0].leaf = true;
+    _compiled = true;
+    _bind();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- TERM MATCHER: MATCHING ------------------------- //
+// Runs the compiled automaton once over the tokens of a text and calls the
+// function with the identifier of each term ending at each token, overlapping
+// occurrences and terms of several dictionaries included: the words of the
+// recent tokens are remembered in a small table sized after the text, so that
+// frequent tokens do not reach the tables of large dictionaries every time,
+// the table being kept by the thread from one text to the next
+template <class F>
+void
+term_matcher::
+match(const view_type& text, F&& f)
+const
+{
+    const char* first = text.data();
+    const char* last = first + text.size();
+    view_type token = tokenizer::next(first, last);
+    static thread_local std::vector<recent> recents;
+    size_type count = 1 << 6;
+    size_type i = 0;
+    hash_type h = 0;
+    id_type s = 0;
+    id_type w = npos;
+    id_type next = npos;
+    bool leaf = true;
+    while (count < (1 << 12) && count * 16 < text.size()) {
+        count <<= 1;
+    }
+    recents.assign(count, recent{nullptr, 0, npos, 0, 0, 0, true});
+    while (!token.empty()) {
+        h = tokenizer::hash(token);
+        i = _index(h, count - 1);
+        if (recents[i].size != token.size() || !tokenizer::equal(
+            token, view_type(recents[i].data, recents[i].size)
+        )) {
+            w = _image.word_slots[_word_slot(token, h)];
+            next = w != npos ? _next(0, w) : npos;
+            next = next != npos ? next : 0;
+            recents[i] = recent{
+                token.data(), static_cast<std::uint32_t>(token.size()), w,
+                next, _image.states[next].first, _image.states[next].last,
+                _image.states[next].leaf
+            };
+        }
+        const recent& r = recents[i];
+        if (leaf || r.word == npos) {
+            s = r.state;
+            leaf = r.leaf;
+            for (id_type k = r.first; k < r.last; ++k) {
+                f(_image.outputs[k]);
+            }
+        } else {
+            next = _next(s, r.word);
+            while (next == npos && s != 0) {
+                s = _image.states[s].fail;
+                next = _next(s, r.word);
+            }
+            s = next != npos ? next : 0;
+            leaf = _image.states[s].leaf;
+            for (id_type k = _image.states[s].first;
+                 k < _image.states[s].last; ++k) {
+                f(_image.outputs[k]);
+            }
+        }
+        token = tokenizer::next(first, last);
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ TERM MATCHER: MANAGEMENT ------------------------ //
+// Removes all the terms and words, keeping the storage for reuse and closing
+// the compiled dictionary file, if any
+void
+term_matcher::
+clear()
+{
+    _map.close();
+    _word_slots.assign(std::max<size_type>(_word_slots.size(), 1),
+                       id_type(npos));
+    _transitions.assign(std::max<size_type>(_transitions.size(), 1),
+                        transition{_empty, npos, 0});
+    _words.clear();
+    _states.resize(1);
+    _states[0] = state{npos, npos, 0, 0, npos, 0, 0, true, {}};
+    _terms.clear();
+    _outputs.clear();
+    _characters.clear();
+    _transition_count = 0;
+    _compiled = true;
+    _bind();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------- TERM MATCHER: INPUT AND OUTPUT --------------------- //
+// Maps a compiled dictionary file and reads the tables in place, replacing
+// the current terms, and returns false if the file is missing or corrupted,
+// including when an identifier or an offset of the tables is out of range
+bool
+term_matcher::
+load(const std::string& filename)
+{
+    memory_map map(filename);
+    header h = header();
+    image tables = image();
+    size_type offset = sizeof(header);
+    bool good = map.size() >= sizeof(header);
+    auto take = [&](std::uint64_t count, size_type size){
+        const char* result = map.data() + offset;
+        good = good && count <= map.size() / size;
+        offset += good ? (count * size + 7) & ~size_type(7) : 0;
+        return result;
+    };
+    auto power = [](std::uint64_t n){
+        return n != 0 && (n & (n - 1)) == 0;
+    };
+    if (good) {
+        std::memcpy(&h, map.data(), sizeof(header));
+    }
+    good = good && std::memcmp(h.magic, magic, magic_size) == 0;
+    tables = image{
+        reinterpret_cast<const id_type*>(take(h.word_slots, sizeof(id_type))),
+        reinterpret_cast<const word*>(take(h.words, sizeof(word))),
+        reinterpret_cast<const transition*>(
+            take(h.transitions, sizeof(transition))
+        ),
+        reinterpret_cast<const state*>(take(h.states, sizeof(state))),
+        reinterpret_cast<const entry*>(take(h.terms, sizeof(entry))),
+        reinterpret_cast<const id_type*>(take(h.outputs, sizeof(id_type))),
+        take(h.characters, sizeof(char)),
+        h.word_slots, h.words, h.transitions, h.states, h.terms, h.outputs,
+        h.characters
+    };
+    good = good && offset == map.size() && h.states > 0;
+    good = good && power(h.word_slots) && power(h.transitions);
+    good = good && h.transition_count < h.transitions && _valid(tables);
+    if (good) {
+        clear();
+        _map = std::move(map);
+        _image = tables;
+        _transition_count = h.transition_count;
+    }
+    return good;
+}
+
+// Saves the compiled tables to a temporary file renamed in place once
+// complete, each table starting on an 8-byte boundary so that the file can be
+// mapped and read in place, and returns false if the automaton is not
+// compiled or if the file cannot be written
+bool
+term_matcher::
+save(const std::string& filename)
+const
+{
+    buffered_writer stream(filename, buffered_writer::sync_type::none);
+    const char padding[8] = {};
+    header h = header{
+        {}, _image.word_slot_count, _image.word_count,
+        _image.transition_slot_count, _transition_count, _image.state_count,
+        _image.term_count, _image.output_count, _image.character_count
+    };
+    auto write = [&](const void* data, size_type size){
+        stream.write(static_cast<const char*>(data), size);
+        stream.write(padding, (8 - size % 8) % 8);
+    };
+    std::memcpy(h.magic, magic, magic_size);
+    write(&h, sizeof(header));
+    write(_image.word_slots, h.word_slots * sizeof(id_type));
+    write(_image.words, h.words * sizeof(word));
+    write(_image.transitions, h.transitions * sizeof(transition));
+    write(_image.states, h.states * sizeof(state));
+    write(_image.terms, h.terms * sizeof(entry));
+    write(_image.outputs, h.outputs * sizeof(id_type));
+    write(_image.characters, h.characters);
+    if (!_compiled) {
+        stream.discard();
+    }
+    return _compiled && stream.commit();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- TERM MATCHER: TABLES -------------------------- //
+// Points the tables read by the lookups and the matching to the storage of
+// the matcher, after it has been modified
+void
+term_matcher::
+_bind()
+noexcept
+{
+    _image = image{
+        _word_slots.data(), _words.data(), _transitions.data(),
+        _states.data(), _terms.data(), _outputs.data(), _characters.data(),
+        _word_slots.size(), _words.size(), _transitions.size(),
+        _states.size(), _terms.size(), _outputs.size(), _characters.size()
+    };
+}
+
+// Copies the tables of a compiled dictionary file into the storage of the
+// matcher and closes the file, so that terms can be added
+void
+term_matcher::
+_thaw()
+{
+    if (_map.is_open()) {
+        _word_slots.assign(_image.word_slots,
+                           _image.word_slots + _image.word_slot_count);
+        _words.assign(_image.words, _image.words + _image.word_count);
+        _transitions.assign(_image.transitions,
+                            _image.transitions + _image.transition_slot_count);
+        _states.assign(_image.states, _image.states + _image.state_count);
+        _terms.assign(_image.terms, _image.terms + _image.term_count);
+        _outputs.assign(_image.outputs, _image.outputs + _image.output_count);
+        _characters.assign(_image.characters, _image.character_count);
+        _map.close();
+        _bind();
+    }
+}
+
+// Checks that every identifier and offset of the tables is within the table
+// it refers to, that the probing of the slots always reaches an empty slot,
+// that failures lead to shallower states and that the terms of a state are
+// chained towards older terms, so that lookups and matching stay in bounds
+// and terminate whatever the content of a compiled dictionary file
+bool
+term_matcher::
+_valid(const image& tables)
+noexcept
+{
+    const std::uint64_t states = tables.state_count;
+    const std::uint64_t words = tables.word_count;
+    const std::uint64_t terms = tables.term_count;
+    const std::uint64_t outputs = tables.output_count;
+    const std::uint64_t characters = tables.character_count;
+    bool word_space = false;
+    bool transition_space = false;
+    bool good = states < npos && words < npos && terms < npos;
+    good = good && outputs < npos;
+    for (size_type k = 0; good && k < tables.word_slot_count; ++k) {
+        word_space = word_space || tables.word_slots[k] == npos;
+        good = tables.word_slots[k] == npos || tables.word_slots[k] < words;
+    }
+    for (size_type k = 0; good && k < words; ++k) {
+        const word& w = tables.words[k];
+        good = std::uint64_t(w.offset) + w.size <= characters;
+        good = good && (w.root == npos || w.root < states);
+    }
+    for (size_type k = 0; good && k < tables.transition_slot_count; ++k) {
+        const transition& t = tables.transitions[k];
+        transition_space = transition_space || t.key == _empty;
+        good = t.key == _empty ? t.next == npos : t.next < states;
+    }
+    for (size_type k = 0; good && k < states; ++k) {
+        const state& s = tables.states[k];
+        good = s.fail < states && s.first <= s.last && s.last <= outputs;
+        good = good && (s.terms == npos || s.terms < terms);
+        good = good && (k == 0 ? s.depth == 0 && s.fail == 0
+                               : s.parent < states && s.word < words
+                              && tables.states[s.fail].depth < s.depth);
+    }
+    for (size_type k = 0; good && k < terms; ++k) {
+        const entry& e = tables.terms[k];
+        good = std::uint64_t(e.offset) + e.size <= characters;
+        good = good && e.state < states && (e.next == npos || e.next < k);
+    }
+    for (size_type k = 0; good && k < outputs; ++k) {
+        good = tables.outputs[k] < terms;
+    }
+    return good && word_space && transition_space;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- TERM MATCHER: PROBING -------------------------- //
+// Folds a hash into a slot index
+term_matcher::size_type
+term_matcher::
+_index(hash_type h, size_type mask)
+noexcept
+{
+    return (h ^ (h >> 32)) & mask;
+}
+
+// Returns the slot holding the identifier of the lowercase version of a
+// token, or the empty slot where it would go
+term_matcher::size_type
+term_matcher::
+_word_slot(const view_type& token, hash_type h)
+const
+{
+    const size_type mask = _image.word_slot_count - 1;
+    size_type i = _index(h, mask);
+    auto same = [this, &token, h](id_type id){
+        const word& w = _image.words[id];
+        const char* key = _image.characters + w.offset;
+        bool result = w.hash == h && w.size == token.size();
+        for (size_type k = 0; result && k < token.size(); ++k) {
+            result = key[k] == tokenizer::lower(token[k]);
+        }
+        return result;
+    };
+    while (_image.word_slots[i] != npos && !same(_image.word_slots[i])) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Returns the slot holding the transition of a state on a word, both packed
+// in a key, or the empty slot where it would go
+term_matcher::size_type
+term_matcher::
+_transition_slot(std::uint64_t key)
+const
+{
+    const size_type mask = _image.transition_slot_count - 1;
+    const transition* transitions = _image.transitions;
+    size_type i = _index(key * 0x9E3779B97F4A7C15ULL, mask);
+    while (transitions[i].key != _empty && transitions[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Returns the identifier of the word of a token, or npos if no term has it
+term_matcher::id_type
+term_matcher::
+_word(const view_type& token)
+const
+{
+    return _image.word_slots[_word_slot(token, tokenizer::hash(token))];
+}
+
+// Returns the state reached from a state on a word, or npos if none, the
+// transitions of the initial state being kept with the words
+term_matcher::id_type
+term_matcher::
+_next(id_type s, id_type w)
+const
+{
+    const std::uint64_t key = (std::uint64_t(s) << 32) | w;
+    return s == 0 ? _image.words[w].root
+                  : _image.transitions[_transition_slot(key)].next;
+}
+
+// Returns the state reached from the initial state on the tokens of a term,
+// or npos if there is none
+term_matcher::id_type
+term_matcher::
+_walk(const view_type& term)
+const
+{
+    id_type s = 0;
+    id_type w = npos;
+    for (auto&& token: tokenizer(term)) {
+        w = s != npos ? _word(token) : npos;
+        s = w != npos ? _next(s, w) : npos;
+    }
+    return s;
+}
+
+// Doubles the number of word slots and reinserts the word identifiers
+void
+term_matcher::
+_grow_words()
+{
+    std::vector<id_type> slots(_word_slots.size() * 2, id_type(npos));
+    const size_type mask = slots.size() - 1;
+    size_type i = 0;
+    for (id_type id = 0; id < _words.size(); ++id) {
+        i = _index(_words[id].hash, mask);
+        while (slots[i] != npos) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+    _word_slots.swap(slots);
+    _bind();
+}
+
+// Doubles the number of transition slots and reinserts the transitions
+void
+term_matcher::
+_grow_transitions()
+{
+    std::vector<transition> transitions(_transitions.size() * 2,
+                                        transition{_empty, npos, 0});
+    _transitions.swap(transitions);
+    _bind();
+    for (auto&& t: transitions) {
+        if (t.key != _empty) {
+            _transitions[_transition_slot(t.key)] = t;
+        }
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _TERM_MATCHER_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,349 @@
+// =============================== TOKENIZER ================================ //
+// Project:         epidemium_oncobase
+// Name:            tokenizer.hpp
+// Description:     A zero-copy tokenizer of text into words
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * tokenizer.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _TOKENIZER_HPP_INCLUDED
+#define _TOKENIZER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+// Include others
+#include "string_view.hpp"
+#include "character_class.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************* TOKENIZER ******************************** */
+// Tokenizer class definition
+class tokenizer
+{
+    // Types
+    public:
+    using view_type = string_view;
+    using value_type = view_type::value_type;
+    using size_type = view_type::size_type;
+    using const_pointer = view_type::const_pointer;
+    class iterator;
+
+    // Lifecycle
+    public:
+    explicit tokenizer(const view_type& text = view_type());
+
+    // Iterators
+    public:
+    iterator begin() const;
+    iterator end() const;
+
+    // Classification
+    public:
+    static bool is_separator(value_type c);
+    static bool is_punctuation(value_type c);
+    static value_type lower(value_type c);
+    static void lowercase(const view_type& token, std::string& word);
+    static std::size_t hash(const view_type& token);
+    static bool equal(const view_type& token, const view_type& other);
+
+    // Scanning
+    public:
+    static view_type next(const_pointer& first, const_pointer last);
+
+    // Implementation details: data members
+    private:
+    view_type _text;
+};
+
+// Tokenizer iterator class definition
+class tokenizer::iterator
+{
+    // Types
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = view_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    // Lifecycle
+    public:
+    iterator();
+    iterator(const_pointer first, const_pointer last);
+
+    // Access
+    public:
+    reference operator*() const noexcept;
+    pointer operator->() const noexcept;
+
+    // Increment
+    public:
+    iterator& operator++();
+    iterator operator++(int);
+
+    // Comparison
+    public:
+    friend bool operator==(const iterator& lhs, const iterator& rhs);
+    friend bool operator!=(const iterator& lhs, const iterator& rhs);
+
+    // Implementation details: data members
+    private:
+    const_pointer _next;
+    const_pointer _last;
+    value_type _token;
+};
+/* ************************************************************************** */
+
+
+
+// -------------------------- TOKENIZER: LIFECYCLE -------------------------- //
+// Constructs a tokenizer over a text, without copying it
+tokenizer::
+tokenizer(const view_type& text)
+: _text(text)
+{
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- TOKENIZER: ITERATORS -------------------------- //
+// Returns an iterator to the first token
+tokenizer::iterator
+tokenizer::
+begin()
+const
+{
+    const_pointer first = _text.size() ? _text.data() : nullptr;
+    return iterator(first, first + _text.size());
+}
+
+// Returns an iterator past the last token
+tokenizer::iterator
+tokenizer::
+end()
+const
+{
+    const_pointer first = _text.size() ? _text.data() : nullptr;
+    return iterator(first + _text.size(), first + _text.size());
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------- TOKENIZER: CLASSIFICATION ------------------------ //
+// Checks whether a character separates tokens
+bool
+tokenizer::
+is_separator(value_type c)
+{
+    return character_class::is(c, character_class::separator);
+}
+
+// Checks whether a character is stripped from both ends of tokens
+bool
+tokenizer::
+is_punctuation(value_type c)
+{
+    return character_class::is(c, character_class::punctuation);
+}
+
+// Converts a character to lowercase
+tokenizer::value_type
+tokenizer::
+lower(value_type c)
+{
+    return character_class::to_lower(c);
+}
+
+// Copies a token in lowercase into a word, reusing its storage
+void
+tokenizer::
+lowercase(const view_type& token, std::string& word)
+{
+    word.resize(token.size());
+    if (token.size()) {
+        character_class::lowercase(token.data(), token.data() + token.size(),
+                                   &word[0]);
+    }
+}
+
+// Hashes the lowercase version of a token without converting it
+std::size_t
+tokenizer::
+hash(const view_type& token)
+{
+    std::uint64_t result = 14695981039346656037ULL;
+    for (auto&& c: token) {
+        result ^= static_cast<unsigned char>(lower(c));
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+// Checks whether two tokens are the same word once in lowercase
+bool
+tokenizer::
+equal(const view_type& token, const view_type& other)
+{
+    const size_type n = token.size();
+    bool result = n == other.size();
+    for (size_type i = 0; result && i < n; ++i) {
+        result = lower(token[i]) == lower(other[i]);
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- TOKENIZER: SCANNING --------------------------- //
+// Returns the next token stripped of its punctuation and moves first past it,
+// or returns an empty token at the end of the text
+tokenizer::view_type
+tokenizer::
+next(const_pointer& first, const_pointer last)
+{
+    const character_class::table_type& table = character_class::table();
+    auto is_punctuation = [&table](value_type c){
+        return table[static_cast<unsigned char>(c)]
+             & character_class::punctuation;
+    };
+    const_pointer begin = first;
+    const_pointer end = first;
+    while (begin == end && first != last) {
+        begin = character_class::find_non_separator(first, last);
+        end = character_class::find_separator(begin, last);
+        first = end;
+        while (begin != end && is_punctuation(*begin)) {
+            ++begin;
+        }
+        while (end != begin && is_punctuation(*(end - 1))) {
+            --end;
+        }
+    }
+    return begin != end ? view_type(begin, end - begin) : view_type();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------- TOKENIZER ITERATOR: LIFECYCLE ---------------------- //
+// Constructs an iterator without any text
+tokenizer::iterator::
+iterator()
+: _next()
+, _last()
+, _token()
+{
+}
+
+// Constructs an iterator to the first token of a text
+tokenizer::iterator::
+iterator(const_pointer first, const_pointer last)
+: _next(first)
+, _last(last)
+, _token()
+{
+    _token = tokenizer::next(_next, _last);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------- TOKENIZER ITERATOR: ACCESS ----------------------- //
+// Returns the current token
+tokenizer::iterator::reference
+tokenizer::iterator::
+operator*()
+const noexcept
+{
+    return _token;
+}
+
+// Returns a pointer to the current token
+tokenizer::iterator::pointer
+tokenizer::iterator::
+operator->()
+const noexcept
+{
+    return &_token;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------- TOKENIZER ITERATOR: INCREMENT ---------------------- //
+// Moves to the next token
+tokenizer::iterator&
+tokenizer::iterator::
+operator++()
+{
+    _token = tokenizer::next(_next, _last);
+    return *this;
+}
+
+// Moves to the next token and returns the previous position
+tokenizer::iterator
+tokenizer::iterator::
+operator++(int)
+{
+    iterator previous(*this);
+    ++*this;
+    return previous;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------- TOKENIZER ITERATOR: COMPARISON --------------------- //
+// Checks whether two iterators point to the same token
+bool
+operator==(const tokenizer::iterator& lhs, const tokenizer::iterator& rhs)
+{
+    return lhs._next == rhs._next && lhs._token.size() == rhs._token.size();
+}
+
+// Checks whether two iterators point to different tokens
+bool
+operator!=(const tokenizer::iterator& lhs, const tokenizer::iterator& rhs)
+{
+    return !(lhs == rhs);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _TOKENIZER_HPP_INCLUDED
+// ========================================================================== //
@@ -0,0 +1,227 @@
+// ================================== UTF8 ================================== //
+// Project:         epidemium_oncobase
+// Name:            utf8.hpp
+// Description:     Validation and repair of utf-8 encoded text
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * utf8.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _UTF8_HPP_INCLUDED
+#define _UTF8_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+// Include others
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ********************************** UTF8 ********************************** */
+// Replacement character U+FFFD
+constexpr const char* utf8_replacement = "\xEF\xBF\xBD";
+
+// Functions
+const char* utf8_skip_ascii(const char* first, const char* last);
+std::size_t utf8_sequence_length(const char* first, const char* last);
+const char* utf8_validate(const char* first, const char* last);
+bool utf8_is_valid(const std::string& text);
+std::size_t utf8_repair(std::string& text);
+void utf8_append(std::uint32_t code, std::string& text);
+/* ************************************************************************** */
+
+
+
+// ------------------------------ UTF8: SCANNING ---------------------------- //
+// Skips the leading ascii characters, 32 or 16 bytes at a time when possible
+const char*
+utf8_skip_ascii(const char* first, const char* last)
+{
+    int mask = 0;
+#if defined(__AVX2__)
+    __m256i chunk;
+    while (last - first >= 32) {
+        chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        mask = _mm256_movemask_epi8(chunk);
+        if (mask) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i block;
+    while (last - first >= 16) {
+        block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        mask = _mm_movemask_epi8(block);
+        if (mask) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 16;
+    }
+#endif
+    (void)(mask);
+    while (first < last && !(static_cast<unsigned char>(*first) & 0x80)) {
+        ++first;
+    }
+    return first;
+}
+
+// Returns the length of the valid sequence starting at first, or zero
+std::size_t
+utf8_sequence_length(const char* first, const char* last)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(first);
+    const std::ptrdiff_t n = last - first;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    std::size_t length = 0;
+    if (n > 0) {
+        if (p[0] < 0x80) {
+            length = 1;
+        } else if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+            length = 2;
+        } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+            low = p[0] == 0xE0 ? 0xA0 : low;
+            high = p[0] == 0xED ? 0x9F : high;
+            length = 3;
+        } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+            low = p[0] == 0xF0 ? 0x90 : low;
+            high = p[0] == 0xF4 ? 0x8F : high;
+            length = 4;
+        }
+        if (length > 1) {
+            if (n < static_cast<std::ptrdiff_t>(length)) {
+                length = 0;
+            } else if (p[1] < low || p[1] > high) {
+                length = 0;
+            } else if (length > 2 && (p[2] & 0xC0) != 0x80) {
+                length = 0;
+            } else if (length > 3 && (p[3] & 0xC0) != 0x80) {
+                length = 0;
+            }
+        }
+    }
+    return length;
+}
+
+// Returns the first byte of the first invalid sequence, or last
+const char*
+utf8_validate(const char* first, const char* last)
+{
+    std::size_t length = 0;
+    while (first < last) {
+        first = utf8_skip_ascii(first, last);
+        if (first < last) {
+            length = utf8_sequence_length(first, last);
+            if (length == 0) {
+                break;
+            }
+            first += length;
+        }
+    }
+    return first;
+}
+
+// Checks whether a string only contains valid utf-8 sequences
+bool
+utf8_is_valid(const std::string& text)
+{
+    const char* last = text.data() + text.size();
+    return utf8_validate(text.data(), last) == last;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------------ UTF8: REPAIR ------------------------------ //
+// Replaces invalid bytes by U+FFFD and returns the number of replacements
+std::size_t
+utf8_repair(std::string& text)
+{
+    const char* first = text.data();
+    const char* last = first + text.size();
+    const char* invalid = utf8_validate(first, last);
+    const char* valid = invalid;
+    std::size_t count = 0;
+    std::string repaired;
+    if (invalid != last) {
+        repaired.reserve(text.size() + text.size() / 8);
+        repaired.append(first, invalid);
+        while (invalid != last) {
+            repaired.append(utf8_replacement);
+            ++count;
+            valid = invalid + 1;
+            invalid = utf8_validate(valid, last);
+            repaired.append(valid, invalid);
+        }
+        text.swap(repaired);
+    }
+    return count;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ----------------------------- UTF8: ENCODING ----------------------------- //
+// Appends the encoding of a code point, or U+FFFD if it is not a scalar value
+void
+utf8_append(std::uint32_t code, std::string& text)
+{
+    if (code < 0x80) {
+        text.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        text.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000 && (code < 0xD800 || code > 0xDFFF)) {
+        text.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code >= 0x10000 && code < 0x110000) {
+        text.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        text.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        text.append(utf8_replacement);
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _UTF8_HPP_INCLUDED
+// ========================================================================== //
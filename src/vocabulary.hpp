@@ -0,0 +1,307 @@
+// =============================== VOCABULARY =============================== //
+// Project:         epidemium_oncobase
+// Name:            vocabulary.hpp
+// Description:     A thread-safe mapping of words to dense integer identifiers
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * vocabulary.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _VOCABULARY_HPP_INCLUDED
+#define _VOCABULARY_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <shared_mutex>
+// Include others
+#include "arena.hpp"
+#include "string_view.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ******************************* VOCABULARY ******************************* */
+// Vocabulary class definition
+class vocabulary
+{
+    // Types
+    public:
+    using view_type = string_view;
+    using size_type = std::size_t;
+    using id_type = std::uint32_t;
+    using hash_type = std::uint32_t;
+    using mutex_type = std::shared_timed_mutex;
+
+    // Constants
+    public:
+    static constexpr id_type npos = static_cast<id_type>(-1);
+    static constexpr size_type capacity = 1 << 12;
+
+    // Lifecycle
+    public:
+    explicit vocabulary(size_type ncapacity = capacity);
+    vocabulary(const vocabulary& other) = delete;
+
+    // Assignment
+    public:
+    vocabulary& operator=(const vocabulary& other) = delete;
+
+    // Access
+    public:
+    size_type size() const;
+    bool empty() const;
+    size_type memory() const;
+    view_type word(id_type id) const;
+    id_type find(const view_type& word) const;
+
+    // Insertion
+    public:
+    id_type insert(const view_type& word);
+
+    // Management
+    public:
+    void clear();
+
+    // Implementation details: entries
+    private:
+    struct entry
+    {
+        const char* key;
+        std::uint32_t size;
+        hash_type hash;
+    };
+
+    // Implementation details: probing
+    private:
+    static hash_type _hash(const view_type& word);
+    size_type _slot(const view_type& word, hash_type h) const;
+    void _grow();
+
+    // Implementation details: data members
+    private:
+    std::vector<id_type> _slots;
+    std::vector<entry> _entries;
+    arena _keys;
+    mutable mutex_type _mutex;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------- VOCABULARY: LIFECYCLE -------------------------- //
+// Constructs an empty vocabulary with a number of slots rounded to a power of 2
+vocabulary::
+vocabulary(size_type ncapacity)
+: _slots()
+, _entries()
+, _keys()
+, _mutex()
+{
+    size_type n = 1;
+    while (n < ncapacity) {
+        n <<= 1;
+    }
+    _slots.assign(n, id_type(npos));
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// --------------------------- VOCABULARY: ACCESS --------------------------- //
+// Returns the number of words, which is also the next identifier
+vocabulary::size_type
+vocabulary::
+size()
+const
+{
+    std::shared_lock<mutex_type> lock(_mutex);
+    return _entries.size();
+}
+
+// Checks whether the vocabulary holds no word
+bool
+vocabulary::
+empty()
+const
+{
+    return size() == 0;
+}
+
+// Returns the number of bytes held by the index, the entries and the words
+vocabulary::size_type
+vocabulary::
+memory()
+const
+{
+    std::shared_lock<mutex_type> lock(_mutex);
+    return _slots.capacity() * sizeof(id_type)
+         + _entries.capacity() * sizeof(entry)
+         + _keys.capacity();
+}
+
+// Returns the word of an identifier, the view remaining valid until the
+// vocabulary is cleared
+vocabulary::view_type
+vocabulary::
+word(id_type id)
+const
+{
+    std::shared_lock<mutex_type> lock(_mutex);
+    const entry& e = _entries.at(id);
+    return e.size ? view_type(e.key, e.size) : view_type();
+}
+
+// Returns the identifier of a word, or npos if the word is unknown
+vocabulary::id_type
+vocabulary::
+find(const view_type& word)
+const
+{
+    const hash_type h = _hash(word);
+    std::shared_lock<mutex_type> lock(_mutex);
+    return _slots[_slot(word, h)];
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- VOCABULARY: INSERTION -------------------------- //
+// Returns the identifier of a word, giving the next one to unknown words
+vocabulary::id_type
+vocabulary::
+insert(const view_type& word)
+{
+    const hash_type h = _hash(word);
+    id_type id = npos;
+    size_type i = 0;
+    char* key = nullptr;
+    {
+        std::shared_lock<mutex_type> lock(_mutex);
+        id = _slots[_slot(word, h)];
+    }
+    if (id == npos) {
+        std::unique_lock<mutex_type> lock(_mutex);
+        i = _slot(word, h);
+        id = _slots[i];
+        if (id == npos) {
+            if ((_entries.size() + 1) * 4 > _slots.size() * 3) {
+                _grow();
+                i = _slot(word, h);
+            }
+            key = _keys.allocate(word.size());
+            std::copy(word.begin(), word.end(), key);
+            id = static_cast<id_type>(_entries.size());
+            _entries.push_back(entry{
+                key, static_cast<std::uint32_t>(word.size()), h
+            });
+            _slots[i] = id;
+        }
+    }
+    return id;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- VOCABULARY: MANAGEMENT ------------------------- //
+// Removes all the words, invalidating the identifiers and the views
+void
+vocabulary::
+clear()
+{
+    std::unique_lock<mutex_type> lock(_mutex);
+    std::fill(_slots.begin(), _slots.end(), id_type(npos));
+    _entries.clear();
+    _keys.clear();
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- VOCABULARY: PROBING --------------------------- //
+// Hashes the characters of a word
+vocabulary::hash_type
+vocabulary::
+_hash(const view_type& word)
+{
+    std::uint64_t result = 14695981039346656037ULL;
+    for (auto&& c: word) {
+        result ^= static_cast<unsigned char>(c);
+        result *= 1099511628211ULL;
+    }
+    return static_cast<hash_type>(result ^ (result >> 32));
+}
+
+// Returns the slot holding the identifier of a word, or the empty slot where
+// it would go, the lock being held by the caller
+vocabulary::size_type
+vocabulary::
+_slot(const view_type& word, hash_type h)
+const
+{
+    const size_type mask = _slots.size() - 1;
+    size_type i = h & mask;
+    auto same = [this, &word, h](id_type id){
+        const entry& e = _entries[id];
+        return e.hash == h
+            && e.size == word.size()
+            && std::equal(word.begin(), word.end(), e.key);
+    };
+    while (_slots[i] != npos && !same(_slots[i])) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Doubles the number of slots and reinserts the identifiers
+void
+vocabulary::
+_grow()
+{
+    std::vector<id_type> slots(_slots.size() * 2, id_type(npos));
+    const size_type mask = slots.size() - 1;
+    size_type i = 0;
+    for (id_type id = 0; id < _entries.size(); ++id) {
+        i = _entries[id].hash & mask;
+        while (slots[i] != npos) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+    _slots.swap(slots);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _VOCABULARY_HPP_INCLUDED
+// ========================================================================== //
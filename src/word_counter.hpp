@@ -0,0 +1,363 @@
+// ============================== WORD COUNTER ============================== //
+// Project:         epidemium_oncobase
+// Name:            word_counter.hpp
+// Description:     An open-addressing hash table counting words
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * word_counter.hpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+#ifndef _WORD_COUNTER_HPP_INCLUDED
+#define _WORD_COUNTER_HPP_INCLUDED
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+// Include others
+#include "arena.hpp"
+#include "tokenizer.hpp"
+#include "vocabulary.hpp"
+#include "string_view.hpp"
+#include "character_class.hpp"
+#include "distribution.hpp"
+// Miscellaneous
+namespace epidemium_oncobase {
+// ========================================================================== //
+
+
+
+/* ****************************** WORD COUNTER ****************************** */
+// Word counter class definition
+class word_counter
+{
+    // Types
+    public:
+    using view_type = string_view;
+    using size_type = std::size_t;
+    using count_type = std::size_t;
+    using hash_type = std::uint32_t;
+    using id_type = vocabulary::id_type;
+    using id_distribution = std::vector<std::pair<id_type, count_type>>;
+
+    // Constants
+    public:
+    static constexpr size_type capacity = 1 << 10;
+
+    // Lifecycle
+    public:
+    explicit word_counter(size_type ncapacity = capacity);
+
+    // Access
+    public:
+    size_type size() const noexcept;
+    size_type slot_count() const noexcept;
+    bool empty() const noexcept;
+    size_type memory() const noexcept;
+    count_type count(const view_type& token) const;
+
+    // Counting
+    public:
+    void add(const view_type& token, count_type n = 1);
+
+    // Export
+    public:
+    template <class F>
+    void for_each(F&& f) const;
+    distribution to_distribution(count_type minimum = 0) const;
+    void to_distribution(distribution& result, count_type minimum = 0) const;
+    void to_ids(id_distribution& result, vocabulary& words,
+                count_type minimum = 0) const;
+
+    // Management
+    public:
+    void clear() noexcept;
+
+    // Implementation details: slots
+    private:
+    struct slot
+    {
+        const char* key;
+        count_type count;
+        hash_type hash;
+        std::uint32_t size;
+    };
+
+    // Implementation details: probing
+    private:
+    static hash_type _hash(const view_type& token);
+    static bool _same(const slot& s, const view_type& token, hash_type h);
+    size_type _find(const view_type& token, hash_type h) const;
+    void _grow();
+
+    // Implementation details: data members
+    private:
+    std::vector<slot> _slots;
+    arena _keys;
+    size_type _size;
+};
+/* ************************************************************************** */
+
+
+
+// ------------------------ WORD COUNTER: LIFECYCLE ------------------------- //
+// Constructs an empty counter with a number of slots rounded to a power of 2
+word_counter::
+word_counter(size_type ncapacity)
+: _slots()
+, _keys()
+, _size(0)
+{
+    size_type n = 1;
+    while (n < ncapacity) {
+        n <<= 1;
+    }
+    _slots.assign(n, slot{nullptr, 0, 0, 0});
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- WORD COUNTER: ACCESS -------------------------- //
+// Returns the number of distinct words
+word_counter::size_type
+word_counter::
+size()
+const noexcept
+{
+    return _size;
+}
+
+// Returns the number of slots of the table
+word_counter::size_type
+word_counter::
+slot_count()
+const noexcept
+{
+    return _slots.size();
+}
+
+// Checks whether no word has been counted
+bool
+word_counter::
+empty()
+const noexcept
+{
+    return _size == 0;
+}
+
+// Returns the number of bytes held by the table and the interned words
+word_counter::size_type
+word_counter::
+memory()
+const noexcept
+{
+    return _slots.capacity() * sizeof(slot) + _keys.capacity();
+}
+
+// Returns the count of a word, whatever the case of the token
+word_counter::count_type
+word_counter::
+count(const view_type& token)
+const
+{
+    return _slots[_find(token, _hash(token))].count;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- WORD COUNTER: COUNTING ------------------------- //
+// Counts a token in lowercase, interning it on its first occurrence
+void
+word_counter::
+add(const view_type& token, count_type n)
+{
+    const hash_type h = _hash(token);
+    size_type i = _find(token, h);
+    char* key = nullptr;
+    if (!_slots[i].key) {
+        if ((_size + 1) * 4 > _slots.size() * 3) {
+            _grow();
+            i = _find(token, h);
+        }
+        key = _keys.allocate(token.size());
+        if (token.size()) {
+            character_class::lowercase(token.data(),
+                                       token.data() + token.size(), key);
+        }
+        _slots[i] = slot{key, 0, h, static_cast<std::uint32_t>(token.size())};
+        ++_size;
+    }
+    _slots[i].count += n;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------- WORD COUNTER: EXPORT -------------------------- //
+// Calls a function on each lowercase word and its count, in no given order
+template <class F>
+void
+word_counter::
+for_each(F&& f)
+const
+{
+    for (auto&& s: _slots) {
+        if (s.key) {
+            f(s.size ? view_type(s.key, s.size) : view_type(), s.count);
+        }
+    }
+}
+
+// Exports the words counted at least the minimum number of times with their
+// counts, in no given order
+distribution
+word_counter::
+to_distribution(count_type minimum)
+const
+{
+    distribution result;
+    to_distribution(result, minimum);
+    return result;
+}
+
+// Exports the words counted at least the minimum number of times with their
+// counts into an existing distribution, reusing its storage
+void
+word_counter::
+to_distribution(distribution& result, count_type minimum)
+const
+{
+    result.clear();
+    result.reserve(_size, _keys.size());
+    for_each([&result, minimum](const view_type& word, count_type n){
+        if (n >= minimum) {
+            result.push_back(word, n);
+        }
+    });
+}
+
+// Exports the identifiers in a shared vocabulary of the words counted at
+// least the minimum number of times with their counts into an existing
+// distribution, in no given order, inserting the words new to the vocabulary
+void
+word_counter::
+to_ids(id_distribution& result, vocabulary& words, count_type minimum)
+const
+{
+    result.clear();
+    result.reserve(_size);
+    for_each([&result, &words, minimum](const view_type& word, count_type n){
+        if (n >= minimum) {
+            result.emplace_back(words.insert(word), n);
+        }
+    });
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------ WORD COUNTER: MANAGEMENT ------------------------ //
+// Removes all the words, keeping the slots and the arena for reuse
+void
+word_counter::
+clear()
+noexcept
+{
+    if (_size) {
+        std::fill(_slots.begin(), _slots.end(), slot{nullptr, 0, 0, 0});
+    }
+    _keys.clear();
+    _size = 0;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ------------------------- WORD COUNTER: PROBING -------------------------- //
+// Hashes the lowercase version of a token
+word_counter::hash_type
+word_counter::
+_hash(const view_type& token)
+{
+    const std::uint64_t h = tokenizer::hash(token);
+    return static_cast<hash_type>(h ^ (h >> 32));
+}
+
+// Checks whether a slot holds the lowercase version of a token
+bool
+word_counter::
+_same(const slot& s, const view_type& token, hash_type h)
+{
+    bool result = s.hash == h && s.size == token.size();
+    for (size_type i = 0; result && i < token.size(); ++i) {
+        result = s.key[i] == tokenizer::lower(token[i]);
+    }
+    return result;
+}
+
+// Returns the slot holding a token, or the empty slot where it would go
+word_counter::size_type
+word_counter::
+_find(const view_type& token, hash_type h)
+const
+{
+    const size_type mask = _slots.size() - 1;
+    size_type i = h & mask;
+    while (_slots[i].key && !_same(_slots[i], token, h)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Doubles the number of slots and reinserts the words
+void
+word_counter::
+_grow()
+{
+    std::vector<slot> slots(_slots.size() * 2, slot{nullptr, 0, 0, 0});
+    const size_type mask = slots.size() - 1;
+    size_type i = 0;
+    for (auto&& s: _slots) {
+        if (s.key) {
+            i = s.hash & mask;
+            while (slots[i].key) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = s;
+        }
+    }
+    _slots.swap(slots);
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// ========================================================================== //
+} // namespace epidemium_oncobase
+#endif // _WORD_COUNTER_HPP_INCLUDED
+// ========================================================================== //
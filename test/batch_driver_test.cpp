@@ -0,0 +1,258 @@
+// =========================== BATCH DRIVER TEST ============================ //
+// Project:         epidemium_oncobase
+// Name:            batch_driver_test.cpp
+// Description:     Kills a checkpointed run and resumes it on several threads
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * batch_driver_test.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O2 -I../src
+//                  batch_driver_test.cpp -o batch_driver_test -lstdc++fs
+//                  -lpthread
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <experimental/filesystem>
+// Include others
+#include <unistd.h>
+#include <sys/wait.h>
+#include "memory_map.hpp"
+#include "batch_driver.hpp"
+#include "buffered_writer.hpp"
+#include "directory_walker.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using std::experimental::filesystem::path;
+using std::experimental::filesystem::remove;
+using std::experimental::filesystem::remove_all;
+using std::experimental::filesystem::directory_iterator;
+using std::experimental::filesystem::create_directories;
+using std::experimental::filesystem::temp_directory_path;
+// ========================================================================== //
+
+
+
+// ------------------------------- TEST TREE -------------------------------- //
+// Creates a tree of directories holding empty articles and nested
+// subdirectories holding more of them
+void make_tree(const path& root, std::size_t directories, std::size_t files)
+{
+    path directory;
+    std::string name;
+    for (std::size_t i = 0; i < directories; ++i) {
+        directory = root / ("journal_" + std::to_string(i));
+        create_directories(directory / "supplement");
+        for (std::size_t j = 0; j < files; ++j) {
+            name = "article_" + std::to_string(j) + ".txt";
+            std::ofstream(directory / name);
+        }
+        for (std::size_t j = 0; j < files / 4; ++j) {
+            name = std::to_string(j) + ".txt";
+            std::ofstream(directory / "supplement" / name);
+        }
+    }
+}
+// -------------------------------------------------------------------------- //
+
+
+
+// -------------------------------- TEST RUN -------------------------------- //
+// Outcome of a run: shards processed, shards resumed, articles seen, shards
+// whose file did not hold their articles, files of shards left in the
+// checkpoint directory, and whether an article was seen twice
+struct outcome
+{
+    std::size_t processed;
+    std::size_t resumed;
+    std::size_t articles;
+    std::size_t stale;
+    std::size_t files;
+    bool repeated;
+};
+
+// Walks a tree in order on a number of threads and runs its articles through
+// a driver with a checkpoint saved every two shards, the file of each shard
+// listing its articles, and exits at once, as if killed, when a shard is
+// about to be processed after the given number of processed shards, if not
+// zero
+outcome run(const path& tree, const std::string& checkpoint,
+            std::size_t threads, std::size_t kill = 0)
+{
+    directory_walker walker(threads, 7, true);
+    batch_driver driver(checkpoint, 16, 2);
+    std::vector<std::string> paths;
+    std::set<std::string> seen;
+    outcome result = {0, 0, 0, 0, 0, false};
+    auto record = [&](auto first, auto last){
+        for (; first != last; ++first) {
+            result.repeated = !seen.insert(*first).second || result.repeated;
+            ++result.articles;
+        }
+    };
+    auto process = [&](std::size_t, auto first, auto last,
+                       const std::string& filename){
+        buffered_writer stream;
+        if (kill && result.processed == kill) {
+            std::_Exit(0);
+        }
+        if (filename.size()) {
+            stream.open(filename, buffered_writer::sync_type::none);
+            for (auto current = first; current != last; ++current) {
+                stream<<*current<<'\n';
+            }
+        }
+        record(first, last);
+        ++result.processed;
+        return filename.empty() || stream.commit();
+    };
+    auto resume = [&](std::size_t, auto first, auto last,
+                      const std::string& filename){
+        memory_map map(filename);
+        std::string expected;
+        for (auto current = first; current != last; ++current) {
+            expected += *current + '\n';
+        }
+        const bool good = map.size() == expected.size()
+                       && std::equal(expected.begin(), expected.end(),
+                                     map.data());
+        if (good) {
+            record(first, last);
+            ++result.resumed;
+        } else {
+            ++result.stale;
+        }
+        return good;
+    };
+    if (checkpoint.size()) {
+        create_directories(checkpoint);
+        driver.load();
+    }
+    walker.walk(tree, [](auto&& p){return p.extension() == ".txt";},
+                [&](auto&& batch){
+        paths.clear();
+        for (auto&& p: batch) {
+            paths.push_back(p.string());
+        }
+        driver.run(paths.begin(), paths.end(), process, resume);
+    });
+    driver.finish(process, resume);
+    if (checkpoint.size()) {
+        for (auto&& entry: directory_iterator(checkpoint)) {
+            result.files += entry.path().filename().string().find("shard_")
+                         == 0;
+        }
+    }
+    return result;
+}
+
+// Prints the outcome of a run and checks that it saw every article once,
+// without any stale shard, with a number of processed shards in range, and
+// with only the files of its own shards left if it had a checkpoint
+bool check(const std::string& name, const outcome& result,
+           std::size_t articles, std::size_t least, std::size_t most,
+           bool checkpoint = true)
+{
+    const std::size_t shards = result.processed + result.resumed;
+    const bool good = result.articles == articles && !result.repeated
+                   && result.stale == 0 && result.processed >= least
+                   && result.processed <= most
+                   && result.files == (checkpoint ? shards : 0);
+    std::cout<<name<<": "<<result.processed<<" processed, ";
+    std::cout<<result.resumed<<" resumed, "<<result.articles<<" articles, ";
+    std::cout<<result.stale<<" stale, "<<result.files<<" files";
+    std::cout<<(good ? "" : " FAILED")<<std::endl;
+    return good;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Runs a whole tree, kills a run after a few shards, resumes it from its last
+// checkpoint and reruns it with other numbers of walker threads, then adds
+// and removes articles and checks that only the shards holding them are
+// processed again, the files of the shards they replace being removed
+int main(int, char**)
+{
+    // Constants
+    static constexpr std::size_t directories = 12;
+    static constexpr std::size_t files = 40;
+    static constexpr std::size_t articles = directories * (files + files / 4);
+    static constexpr std::size_t interrupted = 5;
+    static constexpr std::size_t saved = interrupted - interrupted % 2;
+
+    // Variables
+    const path tree = temp_directory_path()
+                    / ("batch_driver_test_" + std::to_string(::getpid()));
+    const std::string checkpoint = (tree / "checkpoint").string();
+    const path articles_path = tree / "articles";
+    outcome whole = outcome();
+    outcome resumed = outcome();
+    pid_t child = 0;
+    int status = 0;
+    bool good = true;
+
+    // Runs the whole tree without checkpoint, then kills a run with a
+    // checkpoint on three threads after a few shards and resumes it on four,
+    // the shards completed since the last save being processed again
+    make_tree(articles_path, directories, files);
+    whole = run(articles_path, "", 4);
+    good = check("whole", whole, articles, whole.processed, whole.processed,
+                 false);
+    child = ::fork();
+    if (child == 0) {
+        run(articles_path, checkpoint, 3, interrupted);
+        std::_Exit(1);
+    }
+    good = ::waitpid(child, &status, 0) == child && WIFEXITED(status)
+        && WEXITSTATUS(status) == 0 && good;
+    resumed = run(articles_path, checkpoint, 4);
+    good = check("resumed", resumed, articles, whole.processed - saved,
+                 whole.processed - saved) && good;
+    good = resumed.resumed == saved && good;
+
+    // Reruns with other numbers of threads, then after adding an article and
+    // after removing one, each of them changing at most two shards
+    good = check("rerun", run(articles_path, checkpoint, 8), articles, 0, 0)
+        && good;
+    good = check("rerun", run(articles_path, checkpoint, 1), articles, 0, 0)
+        && good;
+    std::ofstream(articles_path / "journal_3" / "article_extra.txt");
+    good = check("added", run(articles_path, checkpoint, 4), articles + 1, 1, 2)
+        && good;
+    remove(articles_path / "journal_7" / "supplement" / "2.txt");
+    good = check("removed", run(articles_path, checkpoint, 4), articles, 1, 2)
+        && good;
+    remove_all(tree);
+    std::cout<<(good ? "PASSED" : "FAILED")<<std::endl;
+    return good ? 0 : 1;
+}
+/* ************************************************************************** */
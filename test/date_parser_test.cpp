@@ -0,0 +1,121 @@
+// ============================ DATE PARSER TEST ============================ //
+// Project:         epidemium_oncobase
+// Name:            date_parser_test.cpp
+// Description:     Checks the date parser against the former regex parsing
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * date_parser_test.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O2 -I../src
+//                  date_parser_test.cpp -o date_parser_test -lstdc++fs
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <ctime>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+// Include others
+#include "date_parser.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+// ========================================================================== //
+
+
+
+// ------------------------------- TEST DATA -------------------------------- //
+// Reads a line of the test data, made of a date, a tab and the six fields
+// expected from it, and returns false if the line is malformed
+bool read_case(const std::string& line, std::string& date, std::tm& expected)
+{
+    const std::string::size_type tab = line.find('\t');
+    std::istringstream fields(tab != std::string::npos ? line.substr(tab) : "");
+    expected = std::tm();
+    date = line.substr(0, tab);
+    fields>>expected.tm_year>>expected.tm_mon>>expected.tm_mday;
+    fields>>expected.tm_hour>>expected.tm_min>>expected.tm_sec;
+    return tab != std::string::npos && !fields.fail();
+}
+
+// Checks whether two dates have the same fields
+bool same(const std::tm& x, const std::tm& y)
+{
+    return x.tm_year == y.tm_year && x.tm_mon == y.tm_mon
+        && x.tm_mday == y.tm_mday && x.tm_hour == y.tm_hour
+        && x.tm_min == y.tm_min && x.tm_sec == y.tm_sec;
+}
+
+// Prints the fields of a date
+std::ostream& print(std::ostream& stream, const std::tm& x)
+{
+    stream<<x.tm_year<<" "<<x.tm_mon<<" "<<x.tm_mday<<" ";
+    return stream<<x.tm_hour<<" "<<x.tm_min<<" "<<x.tm_sec;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Parses every date of the test data given as argument, or of the one of this
+// directory, comparing the fields with the expected ones, and the timestamps,
+// computed and remembered, with the ones of the expected fields
+int main(int argc, char** argv)
+{
+    // Variables
+    const std::string filename = argc > 1 ? argv[1] : "data/dates.txt";
+    std::ifstream stream(filename);
+    std::string line;
+    std::string date;
+    std::tm expected = std::tm();
+    std::tm result = std::tm();
+    date_parser parser;
+    date_parser::time_type time;
+    std::size_t count = 0;
+    std::size_t failures = 0;
+    bool good = true;
+
+    // Checks each date, skipping the comments
+    while (std::getline(stream, line)) {
+        if (line.size() && line[0] != '#') {
+            good = read_case(line, date, expected);
+            result = parser.parse(date);
+            good = good && same(result, expected);
+            time = date_parser::time_type::clock::from_time_t(
+                std::mktime(&expected)
+            );
+            good = good && parser(date) == time && parser(date) == time;
+            if (!good) {
+                std::cout<<"FAILED: "<<line<<" gave ";
+                print(std::cout, result)<<std::endl;
+            }
+            failures += !good;
+            ++count;
+        }
+    }
+    std::cout<<count<<" dates, "<<failures<<" failures"<<std::endl;
+    std::cout<<(count && !failures ? "PASSED" : "FAILED")<<std::endl;
+    return count && !failures ? 0 : 1;
+}
+/* ************************************************************************** */
@@ -0,0 +1,179 @@
+// =========================== TERM MATCHER TEST ============================ //
+// Project:         epidemium_oncobase
+// Name:            term_matcher_test.cpp
+// Description:     Checks the term matcher against a brute-force search
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * term_matcher_test.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O2 -I../src
+//                  term_matcher_test.cpp -o term_matcher_test -lstdc++fs
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <map>
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <experimental/filesystem>
+// Include others
+#include <unistd.h>
+#include "tokenizer.hpp"
+#include "term_matcher.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using std::experimental::filesystem::path;
+using std::experimental::filesystem::remove;
+using std::experimental::filesystem::temp_directory_path;
+// ========================================================================== //
+
+
+
+// ------------------------------- REFERENCE -------------------------------- //
+// Splits a text into its lowercase tokens
+std::vector<std::string> split(const std::string& text)
+{
+    std::vector<std::string> result;
+    for (auto&& token: tokenizer(string_view(text))) {
+        result.emplace_back(token.begin(), token.end());
+        for (auto&& c: result.back()) {
+            c = tokenizer::lower(c);
+        }
+    }
+    return result;
+}
+
+// Finds the terms ending at each token of a text by comparing every term with
+// the tokens before, and returns their sorted identifiers
+std::vector<term_matcher::id_type> search(
+    const std::map<std::string, term_matcher::id_type>& terms,
+    const std::string& text
+)
+{
+    const std::vector<std::string> tokens = split(text);
+    std::vector<term_matcher::id_type> result;
+    std::vector<std::string> words;
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        for (auto&& t: terms) {
+            words = split(t.first);
+            n = words.size();
+            if (n <= i + 1 && std::equal(words.begin(), words.end(),
+                                         tokens.begin() + i + 1 - n)) {
+                result.push_back(t.second);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// Runs a matcher over a text and returns the sorted identifiers it reports
+std::vector<term_matcher::id_type> match(const term_matcher& matcher,
+                                         const std::string& text)
+{
+    std::vector<term_matcher::id_type> result;
+    matcher.match(string_view(text), [&result](term_matcher::id_type id){
+        result.push_back(id);
+    });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Builds dictionaries of random terms of one to three words, from a single
+// term to many of them, so that the automata have states without children
+// falling back to the root, where matching skips the failure transitions, and
+// compares the terms found in random texts, before and after saving and
+// loading the dictionaries, with a brute-force search
+int main(int, char**)
+{
+    // Constants
+    static constexpr std::size_t rounds = 400;
+    static constexpr std::size_t texts = 20;
+    static const std::vector<std::string> words = {
+        "breast", "cancer", "lung", "tumor", "cell", "of", "the", "carcinoma"
+    };
+
+    // Variables
+    const path filename = temp_directory_path()
+                        / ("term_matcher_test_" + std::to_string(::getpid()));
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<std::size_t> pick(0, words.size() - 1);
+    std::uniform_int_distribution<std::size_t> length(1, 3);
+    std::map<std::string, term_matcher::id_type> terms;
+    std::vector<term_matcher::id_type> expected;
+    std::string term;
+    std::string word;
+    std::string text;
+    std::size_t count = 0;
+    std::size_t found = 0;
+    std::size_t failures = 0;
+
+    // Compares the matches of each dictionary with the brute-force search
+    for (std::size_t round = 0; round < rounds; ++round) {
+        term_matcher matcher;
+        term_matcher loaded;
+        terms.clear();
+        for (std::size_t k = 0; k < 1 + round % 24; ++k) {
+            term.clear();
+            for (std::size_t n = length(engine); n > 0; --n) {
+                term += (term.empty() ? "" : " ") + words[pick(engine)];
+            }
+            terms[term] = matcher.insert(term);
+        }
+        matcher.compile();
+        matcher.save(filename.string());
+        loaded.load(filename.string());
+        for (std::size_t t = 0; t < texts; ++t) {
+            text.clear();
+            for (std::size_t n = 0; n < 60; ++n) {
+                word = words[pick(engine)];
+                word[0] = n % 4 == 0 ? std::toupper(word[0]) : word[0];
+                text += word;
+                text += n % 9 == 0 ? ". " : n % 5 == 0 ? ", " : " ";
+            }
+            expected = search(terms, text);
+            if (match(matcher, text) != expected
+            ||  match(loaded, text) != expected) {
+                std::cout<<"FAILED: "<<text<<std::endl;
+                ++failures;
+            }
+            found += expected.size();
+            ++count;
+        }
+    }
+    remove(filename);
+    std::cout<<count<<" texts, "<<found<<" terms found, "<<failures;
+    std::cout<<" failures"<<std::endl;
+    std::cout<<(failures ? "FAILED" : "PASSED")<<std::endl;
+    return failures ? 1 : 0;
+}
+/* ************************************************************************** */
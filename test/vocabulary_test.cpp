@@ -0,0 +1,161 @@
+// ============================ VOCABULARY TEST ============================= //
+// Project:         epidemium_oncobase
+// Name:            vocabulary_test.cpp
+// Description:     Fills a shared vocabulary from articles on several threads
+// Creator:         Vincent Reverdy
+// Contributor(s):  Vincent Reverdy [2015-2016]
+// License:         GNU GPLv3
+// ========================================================================== //
+/** 
+ * vocabulary_test.cpp
+ * Copyleft 2015-2016 by Vincent Reverdy
+ * This file is part of epidemium_oncobase. 
+ * 
+ * epidemium_oncobase is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation, either version 3 of the License, or any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// ========================================================================== //
+// Compilation:     g++ -std=c++14 -Wall -Wextra -pedantic -g -O2 -I../src
+//                  vocabulary_test.cpp -o vocabulary_test -lstdc++fs
+//                  -lpthread
+// ========================================================================== //
+
+
+
+// ============================== PREPROCESSOR ============================== //
+// Include C++
+#include <string>
+#include <thread>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <experimental/filesystem>
+// Include others
+#include <unistd.h>
+#include "article.hpp"
+#include "vocabulary.hpp"
+// Miscellaneous
+using namespace epidemium_oncobase;
+using std::experimental::filesystem::path;
+using std::experimental::filesystem::remove_all;
+using std::experimental::filesystem::create_directories;
+using std::experimental::filesystem::temp_directory_path;
+// ========================================================================== //
+
+
+
+// ------------------------------ TEST ARTICLES ----------------------------- //
+// Writes articles made of words drawn from a common list, in mixed case and
+// with punctuation, and returns their paths
+std::vector<std::string> make_articles(const path& root, std::size_t count)
+{
+    static const std::vector<std::string> words = {
+        "Cancer", "tumor", "BREAST", "cell", "the", "of", "carcinoma",
+        "Lung", "patients", "therapy", "gene", "protein", "expression",
+        "a", "and", "in", "metastasis", "Dose", "survival", "risk"
+    };
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<std::size_t> pick(0, words.size() - 1);
+    std::uniform_int_distribution<std::size_t> number(0, 999);
+    std::vector<std::string> result;
+    std::ofstream stream;
+    create_directories(root);
+    for (std::size_t i = 0; i < count; ++i) {
+        result.push_back((root / ("article_" + std::to_string(i) + ".txt"))
+                         .string());
+        stream.open(result.back());
+        for (std::size_t j = 0; j < 2000; ++j) {
+            stream<<words[pick(engine)];
+            stream<<(j % 7 == 0 ? ", " : j % 13 == 0 ? ".\n" : " ");
+            if (j % 11 == 0) {
+                stream<<"w"<<number(engine)<<" ";
+            }
+        }
+        stream.close();
+    }
+    return result;
+}
+// -------------------------------------------------------------------------- //
+
+
+
+/* ********************************** MAIN ********************************** */
+// Computes the identifier distributions of articles on several threads sharing
+// a vocabulary, and checks that the identifiers are dense, that each of them
+// names a single word, and that each distribution spells out the word
+// distribution of its article
+int main(int, char**)
+{
+    // Constants
+    static constexpr std::size_t count = 48;
+    static constexpr std::size_t threads = 4;
+    static constexpr std::size_t minimum = 2;
+
+    // Variables
+    const path root = temp_directory_path()
+                    / ("vocabulary_test_" + std::to_string(::getpid()));
+    const std::vector<std::string> paths = make_articles(root, count);
+    std::vector<article::id_distribution> ids(count);
+    std::vector<std::thread> workers;
+    std::vector<std::pair<std::string, std::size_t>> spelled;
+    std::vector<std::pair<std::string, std::size_t>> expected;
+    std::vector<std::size_t> seen;
+    vocabulary words(4);
+    article paper;
+    std::size_t failures = 0;
+
+    // Fills the vocabulary from the articles, interleaved across the threads
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t](){
+            article a;
+            for (std::size_t i = t; i < count; i += threads) {
+                a.load(paths[i]);
+                a.compute_id_distribution(ids[i], words, minimum);
+            }
+        });
+    }
+    for (auto&& w: workers) {
+        w.join();
+    }
+
+    // Checks the identifiers and the distributions
+    seen.assign(words.size(), 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        spelled.clear();
+        for (auto&& p: ids[i]) {
+            failures += p.first >= words.size();
+            if (p.first < words.size()) {
+                seen[p.first] = 1;
+                spelled.emplace_back(std::string(words.word(p.first)),
+                                     p.second);
+                failures += words.find(words.word(p.first)) != p.first;
+            }
+        }
+        paper.load(paths[i]);
+        expected = paper.compute_word_distribution(minimum);
+        std::sort(spelled.begin(), spelled.end());
+        std::sort(expected.begin(), expected.end());
+        if (spelled != expected) {
+            std::cout<<"FAILED: "<<paths[i]<<std::endl;
+            ++failures;
+        }
+    }
+    failures += std::count(seen.begin(), seen.end(), 0);
+    remove_all(root);
+    std::cout<<count<<" articles, "<<words.size()<<" words, "<<failures;
+    std::cout<<" failures"<<std::endl;
+    std::cout<<(failures ? "FAILED" : "PASSED")<<std::endl;
+    return failures ? 1 : 0;
+}
+/* ************************************************************************** */